@@ -25,9 +25,14 @@
 
           buildPhase = ''
             mkdir -p $out/bin
-            ${pkgs.clang}/bin/clang -std=c99 -O3 -march=native -flto -ffast-math \
+            ${pkgs.clang}/bin/clang -std=c99 -O3 \
               -D_DEFAULT_SOURCE -D_BSD_SOURCE -D_POSIX_C_SOURCE=200809L \
-              src/ghost.c src/frames.c -o $out/bin/ghost
+              src/ghost-pack.c src/pack.c src/utf8.c src/frames.c -o ghost-pack -lpthread
+            ./ghost-pack -b -z -c frames_pack -o src/frames_pack.c
+            ${pkgs.clang}/bin/clang -std=c99 -O3 -flto \
+              -D_DEFAULT_SOURCE -D_BSD_SOURCE -D_POSIX_C_SOURCE=200809L \
+              src/ghost.c src/decoder.c src/export.c src/fdio.c src/libghost.c src/once.c src/pack.c src/pipeline.c src/pool.c src/power.c src/prefetch.c src/record.c src/simd.c src/stats.c src/store.c src/timeline.c src/trace.c src/utf8.c src/wall.c src/frames_pack.c \
+              -o $out/bin/ghost -lm -lpthread
           '';
 
           installPhase = "true";
@@ -39,6 +44,15 @@
             platforms = platforms.linux;
           };
         };
+        bench = self.packages.${system}.ghost.overrideAttrs (old: {
+          pname = "ghost-bench";
+          buildPhase = old.buildPhase + ''
+            ${pkgs.clang}/bin/clang -std=c99 -O3 -DGHOST_NO_MAIN \
+              -D_DEFAULT_SOURCE -D_BSD_SOURCE -D_POSIX_C_SOURCE=200809L \
+              src/bench.c src/ghost.c src/decoder.c src/export.c src/fdio.c src/libghost.c src/once.c src/pack.c src/pipeline.c src/pool.c src/power.c src/prefetch.c src/record.c src/simd.c src/stats.c src/store.c src/timeline.c src/trace.c src/utf8.c src/wall.c \
+              src/frames_pack.c -o $out/bin/ghost-bench -lm -lpthread
+          '';
+        });
         default = self.packages.${system}.ghost;
       };
 
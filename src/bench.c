@@ -0,0 +1,343 @@
+#include <errno.h>
+#include <math.h>
+
+#include "include/ghost.h"
+
+#define BENCH_SAMPLE_NS 2000000LL
+#define BENCH_MAX 32
+
+struct bench {
+    const char *name;
+    void (*setup)(void);
+    void (*run)(long long iterations);
+};
+
+struct result {
+    char name[64];
+    long long iterations;
+    double mean, median, stddev, min, max;
+};
+
+static volatile size_t sink;
+static const struct frame_slot *frame;
+static struct frame_slot pair[2];
+
+static void setup_geometry(void) {
+    term_rows = 56;
+    term_cols = 115;
+    center_image();
+}
+
+static void setup_frame(void) {
+    load_frames();
+    frame = get_frame(17);
+    compose_frame(frame);
+}
+
+static void setup_pair(void) {
+    load_frames();
+    pair[0] = *get_frame(17);
+    pair[1] = *get_frame(18);
+    reset_screen();
+}
+
+static void run_decode_all(long long n) {
+    for (long long i = 0; i < n; i++) {
+        load_frames();
+        for (size_t f = 0; f < FRAME_COUNT; f++)
+            sink += get_frame(f)->offset[IMAGE_HEIGHT];
+    }
+}
+
+static void run_decode_frame(long long n) {
+    for (long long i = 0; i < n; i++)
+        sink += get_frame((size_t)(i % FRAME_COUNT))->offset[IMAGE_HEIGHT];
+}
+
+static void run_seek(long long n) {
+    for (long long i = 0; i < n; i++) {
+        load_frames();
+        sink += get_frame((size_t)(i * 7919 % FRAME_COUNT))->offset[IMAGE_HEIGHT];
+    }
+}
+
+/* Cold start of playback: open the pack, seek, compose and encode in full. */
+static void run_first_frame(long long n) {
+    for (long long i = 0; i < n; i++) {
+        load_frames();
+        reset_screen();
+        compose_frame(get_frame((size_t)(i * 7919 % FRAME_COUNT)));
+        sink += encode_frame(output);
+    }
+}
+
+static void run_compose(long long n) {
+    for (long long i = 0; i < n; i++)
+        compose_frame(frame);
+    sink += (size_t)buffer[start_col].ch;
+}
+
+static void run_encode_cursor(long long n) {
+    char buf[16];
+
+    for (long long i = 0; i < n; i++)
+        sink += (size_t)(encode_cursor(buf, 1 + (int)(i % 60), 1 + (int)(i % 120)) - buf);
+}
+
+static void run_encode_frame(long long n) {
+    for (long long i = 0; i < n; i++) {
+        reset_screen();
+        sink += encode_frame(output);
+    }
+}
+
+static void run_frame_delta(long long n) {
+    for (long long i = 0; i < n; i++) {
+        compose_frame(&pair[i & 1]);
+        sink += encode_frame(output);
+    }
+}
+
+static void setup_wall(void) {
+    wall = 1;
+    term_rows = 120;
+    term_cols = 400;
+    pool_start(POOL_THREADS_MAX);
+    wall_grid();
+    center_image();
+    load_frames();
+    alloc_buffers();
+}
+
+static void run_wall_frame(long long n) {
+    static long long tick;
+
+    for (long long i = 0; i < n; i++, tick++) {
+        wall_decode(tick);
+        wall_compose();
+        sink += wall_encode(output);
+        wall_ahead();
+    }
+}
+
+static void run_clock(long long n) {
+    for (long long i = 0; i < n; i++)
+        sink += (size_t)get_nanoseconds();
+}
+
+static void run_kbhit(long long n) {
+    for (long long i = 0; i < n; i++)
+        sink += (size_t)kbhit();
+}
+
+static const struct bench benches[] = {
+    {"decode_all", NULL, run_decode_all},
+    {"decode_frame", NULL, run_decode_frame},
+    {"seek", NULL, run_seek},
+    {"first_frame", NULL, run_first_frame},
+    {"compose_frame", setup_frame, run_compose},
+    {"encode_cursor", NULL, run_encode_cursor},
+    {"encode_frame", setup_frame, run_encode_frame},
+    {"frame_delta", setup_pair, run_frame_delta},
+    {"clock", NULL, run_clock},
+    {"kbhit", NULL, run_kbhit},
+    {"wall_frame", setup_wall, run_wall_frame},
+};
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static long long sample(const struct bench *b, long long iterations) {
+    long long start = get_nanoseconds();
+    b->run(iterations);
+    return get_nanoseconds() - start;
+}
+
+static void measure(const struct bench *b, int warmup, int reps,
+                    struct result *r) {
+    double samples[reps];
+    long long iterations = 1;
+
+    if (b->setup) b->setup();
+    while (sample(b, iterations) < BENCH_SAMPLE_NS && iterations < (1LL << 40))
+        iterations *= 2;
+
+    for (int i = 0; i < warmup; i++)
+        sample(b, iterations);
+
+    double sum = 0;
+    for (int i = 0; i < reps; i++) {
+        samples[i] = (double)sample(b, iterations) / iterations;
+        sum += samples[i];
+    }
+
+    r->iterations = iterations;
+    r->mean = sum / reps;
+
+    double var = 0;
+    for (int i = 0; i < reps; i++)
+        var += (samples[i] - r->mean) * (samples[i] - r->mean);
+    r->stddev = reps > 1 ? sqrt(var / (reps - 1)) : 0;
+
+    qsort(samples, reps, sizeof(double), compare_double);
+    r->min = samples[0];
+    r->max = samples[reps - 1];
+    r->median = reps % 2 ? samples[reps / 2] :
+        (samples[reps / 2 - 1] + samples[reps / 2]) / 2;
+    snprintf(r->name, sizeof(r->name), "%s", b->name);
+}
+
+static void write_results(FILE *out, int warmup, int reps,
+                          const struct result *results, int count) {
+    fprintf(out, "{\n  \"version\": 1,\n  \"unit\": \"ns/op\",\n");
+    fprintf(out, "  \"warmup\": %d,\n  \"repetitions\": %d,\n", warmup, reps);
+    fprintf(out, "  \"benchmarks\": [\n");
+
+    for (int i = 0; i < count; i++) {
+        const struct result *r = &results[i];
+        fprintf(out,
+            "    {\"name\": \"%s\", \"iterations\": %lld, \"mean\": %.3f, "
+            "\"median\": %.3f, \"stddev\": %.3f, \"min\": %.3f, \"max\": %.3f}%s\n",
+            r->name, r->iterations, r->mean, r->median, r->stddev, r->min, r->max,
+            i + 1 < count ? "," : "");
+    }
+
+    fprintf(out, "  ]\n}\n");
+}
+
+static double json_number(const char *obj, const char *key) {
+    char pattern[32];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+
+    const char *p = strstr(obj, pattern);
+    return p ? strtod(p + strlen(pattern), NULL) : NAN;
+}
+
+static int read_results(const char *path, struct result *results) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "ghost-bench: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    char line[1024];
+    int count = 0;
+
+    while (fgets(line, sizeof(line), f) && count < BENCH_MAX) {
+        const char *name = strstr(line, "\"name\": \"");
+        if (!name) continue;
+        name += strlen("\"name\": \"");
+
+        struct result *r = &results[count++];
+        size_t len = strcspn(name, "\"");
+        if (len >= sizeof(r->name)) len = sizeof(r->name) - 1;
+        memcpy(r->name, name, len);
+        r->name[len] = '\0';
+        r->median = json_number(line, "median");
+        r->stddev = json_number(line, "stddev");
+    }
+
+    fclose(f);
+    return count;
+}
+
+static int compare(const char *base_path, const char *head_path, double threshold) {
+    struct result base[BENCH_MAX], head[BENCH_MAX];
+    int base_count = read_results(base_path, base);
+    int head_count = read_results(head_path, head);
+    int regressions = 0;
+
+    if (base_count < 0 || head_count < 0) return EXIT_FAILURE;
+
+    printf("%-16s %12s %12s %9s\n", "benchmark", "base ns/op", "head ns/op", "change");
+    for (int i = 0; i < head_count; i++) {
+        const struct result *h = &head[i], *b = NULL;
+        for (int j = 0; j < base_count && !b; j++)
+            if (strcmp(base[j].name, h->name) == 0) b = &base[j];
+
+        if (!b) {
+            printf("%-16s %12s %12.1f %9s\n", h->name, "-", h->median, "new");
+            continue;
+        }
+
+        double change = (h->median - b->median) / b->median * 100;
+        double noise = 2 * (b->stddev + h->stddev);
+        int regressed = change > threshold && h->median - b->median > noise;
+
+        regressions += regressed;
+        printf("%-16s %12.1f %12.1f %+8.1f%%%s\n", h->name, b->median, h->median,
+            change, regressed ? "  REGRESSION" : "");
+    }
+
+    return regressions ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void bench_usage(void) {
+    fprintf(stderr,
+        "usage: ghost-bench [-w warmup] [-r reps] [-o out.json] [name...]\n"
+        "       ghost-bench -c base.json head.json [-t percent]\n");
+}
+
+int main(int argc, char **argv) {
+    const char *out_path = NULL;
+    int warmup = 5, reps = 30, comparing = 0, opt;
+    double threshold = 5;
+
+    while ((opt = getopt(argc, argv, "w:r:o:ct:h")) != -1) {
+        switch (opt) {
+        case 'w': warmup = atoi(optarg); break;
+        case 'r': reps = atoi(optarg); break;
+        case 'o': out_path = optarg; break;
+        case 'c': comparing = 1; break;
+        case 't': threshold = atof(optarg); break;
+        default:
+            bench_usage();
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (comparing) {
+        if (argc - optind != 2) {
+            bench_usage();
+            return EXIT_FAILURE;
+        }
+        return compare(argv[optind], argv[optind + 1], threshold);
+    }
+
+    if (warmup < 0 || reps < 1) {
+        bench_usage();
+        return EXIT_FAILURE;
+    }
+
+    if (load_frames() != 0) {
+        fprintf(stderr, "ghost-bench: embedded frame data is corrupt\n");
+        return EXIT_FAILURE;
+    }
+    setup_geometry();
+    if (alloc_buffers() != 0) return EXIT_FAILURE;
+
+    struct result results[BENCH_MAX];
+    int count = 0;
+
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        int selected = optind == argc;
+        for (int a = optind; a < argc; a++)
+            if (strcmp(argv[a], benches[i].name) == 0) selected = 1;
+        if (!selected) continue;
+
+        measure(&benches[i], warmup, reps, &results[count]);
+        fprintf(stderr, "%-16s %12.1f ns/op  +- %.1f\n", results[count].name,
+            results[count].median, results[count].stddev);
+        count++;
+    }
+
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "ghost-bench: %s: %s\n", out_path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    write_results(out, warmup, reps, results, count);
+    return out == stdout || fclose(out) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,131 @@
+#include <string.h>
+
+#include "include/decoder.h"
+#include "include/simd.h"
+#include "include/utf8.h"
+
+struct pack pack;
+
+/* Set by the shared frame store; decoders then hand out its slots. */
+const struct frame_slot *frame_store;
+
+static const struct cell blank = {' ', 0, 1};
+
+int frames_open(void) {
+    if (pack_open(&pack, frames_pack, frames_pack_size) != 0 ||
+        pack.height != IMAGE_HEIGHT || pack.width > ROW_CELLS_MAX ||
+        pack.frame_count != FRAME_COUNT)
+        return -1;
+    return 0;
+}
+
+/*
+ * Decode a pack row into at most max cells, one per display column. Zero
+ * width code points are dropped and a wide glyph that does not fit is
+ * replaced by a blank.
+ */
+static int parse_row(const char *src, size_t len, struct cell *out, int max) {
+    const char *end = src + len;
+    uint8_t fg = 0;
+    int n = 0;
+
+    while (src < end && n < max) {
+        if (*src == '\x1b') {
+            int param = 0;
+            for (src += 2; src < end && *src >= '0' && *src <= '9'; src++)
+                param = param * 10 + (*src - '0');
+            src++;
+            fg = param == 39 ? 0 : (uint8_t)param;
+            continue;
+        }
+
+        size_t run = simd.ascii_run(src, end);
+        if (run > 0) {
+            if (run > (size_t)(max - n)) run = (size_t)(max - n);
+            simd.widen(out + n, src, run, fg);
+            src += run;
+            n += (int)run;
+            continue;
+        }
+
+        uint32_t ch;
+        src += utf8_decode(src, end, &ch);
+
+        int width = char_width(ch);
+        if (width == 0) continue;
+        if (n + width > max) {
+            out[n++] = blank;
+            break;
+        }
+
+        out[n++] = (struct cell){ch, fg, (uint8_t)width};
+        if (width == 2) out[n++] = (struct cell){0, fg, 0};
+    }
+
+    return n;
+}
+
+void decoder_reset(struct decoder *d) {
+    for (int i = 0; i < RING_FRAMES; i++) d->ring[i].frame = -1;
+    d->head = d->count = 0;
+    pack_rewind(&d->cursor, &pack);
+}
+
+int decoder_next(struct decoder *d) {
+    int index = (d->head + d->count) % RING_FRAMES;
+    const struct frame_slot *prev =
+        &d->ring[(index + RING_FRAMES - 1) % RING_FRAMES];
+    struct frame_slot *slot = &d->ring[index];
+    char row[PACK_ROW_BUF];
+
+    int frame = pack_next(&d->cursor);
+    if (frame < 0) return -1;
+
+    int reuse = frame > 0 && prev->frame == frame - 1;
+    size_t pos = 0;
+
+    for (int i = 0; i < IMAGE_HEIGHT; i++) {
+        slot->offset[i] = pos;
+
+        if (reuse && !pack_row_changed(&d->cursor, i)) {
+            size_t len = prev->offset[i + 1] - prev->offset[i];
+            memcpy(slot->cells + pos, prev->cells + prev->offset[i], len * sizeof(struct cell));
+            pos += len;
+            continue;
+        }
+
+        int len = pack_row(&pack, d->cursor.ids[i], row);
+        if (len < 0) return -1;
+        pos += parse_row(row, len, slot->cells + pos, ROW_CELLS_MAX);
+    }
+
+    slot->offset[IMAGE_HEIGHT] = pos;
+    slot->frame = frame;
+    d->count++;
+    return 0;
+}
+
+void decoder_ahead(struct decoder *d) {
+    if (frame_store) return;
+    while (d->count < RING_FRAMES)
+        if (decoder_next(d) != 0) break;
+}
+
+const struct frame_slot *decoder_get(struct decoder *d, size_t index) {
+    if (frame_store)
+        return index < FRAME_COUNT ? &frame_store[index] : NULL;
+
+    while (d->count > 0 && d->ring[d->head].frame != (int)index) {
+        d->head = (d->head + 1) % RING_FRAMES;
+        d->count--;
+    }
+
+    if (d->count == 0) {
+        if ((d->cursor.frame == pack.frame_count ? 0 : d->cursor.frame) != index &&
+            pack_seek(&d->cursor, index) != 0)
+            return NULL;
+        if (decoder_next(d) != 0) return NULL;
+    }
+
+    return &d->ring[d->head];
+}
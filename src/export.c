@@ -0,0 +1,221 @@
+#include <errno.h>
+#include <math.h>
+#include <sys/wait.h>
+
+#include "include/ghost.h"
+
+#define EXPORT_PREAMBLE CLEAR_SCREEN MOVE_CURSOR_HOME CURSOR_HIDE
+
+const char *export_path;
+double export_fps = 1000000.0 / MICROS_PER_FRAME;
+int export_rows = 56, export_cols = 115;
+
+static char *line;
+
+int export_parse_size(const char *arg) {
+    char x, extra;
+
+    if (sscanf(arg, "%d%c%d%c", &export_cols, &x, &export_rows, &extra) != 3 ||
+        (x != 'x' && x != 'X') || export_cols < 1 || export_rows < 1 ||
+        export_cols > 999 || export_rows > 999)
+        return -1;
+    return 0;
+}
+
+/* When the i-th event of the cast is shown, in microseconds. */
+static long long event_time(long long i) {
+    return llround(i * 1000000.0 / export_fps);
+}
+
+static long render_frame(long long i) {
+    long long tick = event_time(i) / MICROS_PER_FRAME;
+
+    if (wall) {
+        if (wall_decode(tick) != 0) return -1;
+        wall_compose();
+        return (long)wall_encode(output);
+    }
+
+    const struct frame_slot *frame = get_frame(timeline_frame(tick + frame_offset));
+    if (!frame) return -1;
+    compose_frame(frame);
+    return (long)encode_frame(output);
+}
+
+/* JSON string escaping; the encoder only ever emits valid UTF-8. */
+static char *escape(char *ptr, const char *s, size_t len) {
+    static const char hex[] = "0123456789abcdef";
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+
+        if (c == '"' || c == '\\') {
+            *ptr++ = '\\';
+            *ptr++ = (char)c;
+        } else if (c == '\n') {
+            *ptr++ = '\\';
+            *ptr++ = 'n';
+        } else if (c == '\r') {
+            *ptr++ = '\\';
+            *ptr++ = 'r';
+        } else if (c < 0x20 || c == 0x7f) {
+            memcpy(ptr, "\\u00", 4);
+            ptr[4] = hex[c >> 4];
+            ptr[5] = hex[c & 15];
+            ptr += 6;
+        } else {
+            *ptr++ = (char)c;
+        }
+    }
+
+    return ptr;
+}
+
+/*
+ * Format one asciicast event line at ptr. It takes at most
+ * EXPORT_EVENT_SIZE(len) bytes.
+ */
+char *export_event(char *ptr, long long us, char type, const char *data, size_t len) {
+    ptr += sprintf(ptr, "[%lld.%06lld, \"%c\", \"", us / 1000000, us % 1000000, type);
+    ptr = escape(ptr, data, len);
+    memcpy(ptr, "\"]\n", 3);
+    return ptr + 3;
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/*
+ * Render events [first, last) into memory and then hand them to the parent
+ * through fd, so that no worker waits on the others while rendering. The
+ * screen model is primed with the frame before the chunk, which makes the
+ * output the same as that of a single worker.
+ */
+static int render_chunk(long long first, long long last, int fd) {
+    char *data = NULL;
+    size_t size = 0;
+    FILE *f = open_memstream(&data, &size);
+
+    size_t size_max = OUTPUT_SIZE(canvas_rows, term_cols) + sizeof(EXPORT_PREAMBLE);
+    line = malloc(size_max + EXPORT_EVENT_SIZE(size_max));
+    if (!f || !line) return -1;
+
+    if (first > 0 && render_frame(first - 1) < 0) return -1;
+
+    for (long long i = first; i < last; i++) {
+        long len = render_frame(i);
+        if (len < 0) return -1;
+        if (len == 0 && i > 0) continue;
+
+        char *ptr = line;
+        if (i == 0 && !overlay) {
+            memcpy(ptr, EXPORT_PREAMBLE, sizeof(EXPORT_PREAMBLE) - 1);
+            ptr += sizeof(EXPORT_PREAMBLE) - 1;
+        }
+        memcpy(ptr, output, (size_t)len);
+        ptr += len;
+
+        char *event = ptr;
+        ptr = export_event(event, event_time(i), 'o', line, (size_t)(event - line));
+        fwrite(event, 1, ptr - event, f);
+    }
+
+    if (fclose(f) != 0) return -1;
+    return write_all(fd, data, size);
+}
+
+int export_run(void) {
+    /* The cast is replayed by asciicast players, not by the terminal at hand. */
+    rep_supported = 1;
+    term_rows = export_rows;
+    term_cols = export_cols;
+    if (wall) wall_grid();
+    place_image();
+
+    if (!terminal_fits()) {
+        fprintf(stderr, "Export size too small: %dx%d\n", term_cols, term_rows);
+        return -1;
+    }
+    if (alloc_buffers() != 0)
+        return -1;
+
+    int to_stdout = strcmp(export_path, "-") == 0;
+    FILE *out = to_stdout ? stdout : fopen(export_path, "w");
+    if (!out) {
+        fprintf(stderr, "Cannot open export file %s\n", export_path);
+        return -1;
+    }
+
+    long long duration = (long long)FRAME_COUNT * MICROS_PER_FRAME, count = 0;
+    while (event_time(count) < duration) count++;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = cpus < 1 ? 1 : cpus > EXPORT_WORKERS_MAX ? EXPORT_WORKERS_MAX : (int)cpus;
+    if (workers > count) workers = (int)count;
+
+    fprintf(out, "{\"version\": 2, \"width\": %d, \"height\": %d, "
+        "\"env\": {\"TERM\": \"xterm-256color\"}}\n", term_cols, term_rows);
+    fflush(out);
+
+    pid_t pids[EXPORT_WORKERS_MAX];
+    int fds[EXPORT_WORKERS_MAX];
+    int started, status = 0;
+
+    for (started = 0; started < workers; started++) {
+        int pipefd[2];
+        if (pipe(pipefd) != 0) break;
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            long long first = count * started / workers;
+            long long last = count * (started + 1) / workers;
+            close(pipefd[0]);
+            _exit(render_chunk(first, last, pipefd[1]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
+        close(pipefd[1]);
+        if (pid < 0) {
+            close(pipefd[0]);
+            break;
+        }
+        pids[started] = pid;
+        fds[started] = pipefd[0];
+    }
+    if (started < workers) status = -1;
+
+    char chunk[65536];
+    for (int k = 0; k < started; k++) {
+        ssize_t n;
+        while ((n = read(fds[k], chunk, sizeof(chunk))) != 0) {
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) {
+                status = -1;
+                break;
+            }
+            if (status == 0 && fwrite(chunk, 1, (size_t)n, out) != (size_t)n)
+                status = -1;
+        }
+        close(fds[k]);
+
+        int ws;
+        if (waitpid(pids[k], &ws, 0) < 0 || !WIFEXITED(ws) || WEXITSTATUS(ws) != 0)
+            status = -1;
+    }
+
+    if (fflush(out) != 0 || (!to_stdout && fclose(out) != 0))
+        status = -1;
+
+    if (status != 0) {
+        fprintf(stderr, "Export to %s failed\n", export_path);
+        if (!to_stdout) remove(export_path);
+    }
+    return status;
+}
@@ -0,0 +1,116 @@
+#include <errno.h>
+#include <poll.h>
+#include <sys/uio.h>
+
+#include "include/ghost.h"
+
+struct fdio_stats fdio_stats;
+
+static char out_buf[FDIO_OUT_SIZE];
+static size_t out_len;
+
+static char in_buf[FDIO_IN_SIZE];
+static size_t in_pos, in_len;
+
+static int wait_writable(void) {
+    struct pollfd p = {STDOUT_FILENO, POLLOUT, 0};
+    int r = poll(&p, 1, -1);
+    stats_wakeup();
+    return r < 0 && errno != EINTR ? -1 : 0;
+}
+
+/*
+ * Write all of iov, recording each piece as it goes out. Returns the bytes
+ * written, or -1 after an error other than EINTR or EAGAIN.
+ */
+static ssize_t write_all(struct iovec *iov, int count) {
+    ssize_t total = 0;
+
+    while (count > 0) {
+        ssize_t n = writev(STDOUT_FILENO, iov, count);
+        if (n < 0) {
+            if (errno == EINTR ||
+                ((errno == EAGAIN || errno == EWOULDBLOCK) && wait_writable() == 0)) {
+                fdio_stats.retries++;
+                continue;
+            }
+            __atomic_fetch_add(&fdio_stats.errors, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+
+        fdio_stats.writes++;
+        fdio_stats.bytes_out += (unsigned long long)n;
+        total += n;
+
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            record_output(iov->iov_base, iov->iov_len);
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0 && n > 0) {
+            record_output(iov->iov_base, (size_t)n);
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+
+    return total;
+}
+
+void fdio_put(const char *data, size_t len) {
+    if (out_len + len > sizeof(out_buf)) {
+        fdio_write(data, len);
+        return;
+    }
+
+    memcpy(out_buf + out_len, data, len);
+    out_len += len;
+}
+
+ssize_t fdio_write(const char *data, size_t len) {
+    struct iovec iov[2] = {{out_buf, out_len}, {(char *)data, len}};
+    int first = out_len == 0, count = len > 0 ? 2 : 1;
+
+    if (first && len == 0) return 0;
+
+    ssize_t n = write_all(iov + first, count - first);
+    out_len = 0;
+    return n;
+}
+
+int fdio_flush(void) {
+    return fdio_write(NULL, 0) < 0 ? -1 : 0;
+}
+
+static int fill(void) {
+    struct pollfd p = {STDIN_FILENO, POLLIN, 0};
+    ssize_t n;
+
+    if (poll(&p, 1, 0) <= 0 || !(p.revents & POLLIN)) return 0;
+
+    do n = read(STDIN_FILENO, in_buf, sizeof(in_buf));
+    while (n < 0 && errno == EINTR);
+
+    if (n <= 0) {
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            __atomic_fetch_add(&fdio_stats.errors, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    fdio_stats.reads++;
+    fdio_stats.bytes_in += (unsigned long long)n;
+    in_pos = 0;
+    in_len = (size_t)n;
+    return 1;
+}
+
+/* Whether a byte can be read without blocking. */
+int fdio_pending(void) {
+    return in_pos < in_len || fill();
+}
+
+int fdio_getc(void) {
+    if (!fdio_pending()) return EOF;
+    return (unsigned char)in_buf[in_pos++];
+}
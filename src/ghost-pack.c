@@ -0,0 +1,830 @@
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "include/frames.h"
+#include "include/pack.h"
+#include "include/utf8.h"
+
+#define CANDIDATES 3
+
+struct row {
+    const char *data;
+    size_t len;
+    uint32_t first;
+    uint16_t ref;
+    uint8_t depth;
+    size_t cost[CANDIDATES + 1];
+    uint8_t *enc;
+    size_t enc_len;
+};
+
+struct input {
+    size_t frame_count;
+    int height;
+    const char **lines;
+};
+
+struct job {
+    void (*fn)(size_t i, void *arg);
+    void *arg;
+    size_t count;
+    int index;
+    int threads;
+};
+
+static int jobs;
+static int keyframe_interval = PACK_KEYFRAME_INTERVAL;
+static struct input input;
+static char **formatted;
+static size_t *formatted_len;
+static int width;
+static uint16_t *ids;
+static struct row *rows;
+static size_t row_count;
+
+static long long get_microseconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static double elapsed_ms(long long since) {
+    return (get_microseconds() - since) / 1000.0;
+}
+
+static void *run_job(void *p) {
+    struct job *job = p;
+    for (size_t i = job->index; i < job->count; i += job->threads)
+        job->fn(i, job->arg);
+    return NULL;
+}
+
+static void parallel_for(size_t count, void (*fn)(size_t, void *), void *arg) {
+    int threads = jobs;
+    if ((size_t)threads > count) threads = count ? (int)count : 1;
+
+    pthread_t tid[threads];
+    struct job job[threads];
+    int started[threads];
+
+    for (int t = 0; t < threads; t++) {
+        job[t] = (struct job){fn, arg, count, t, threads};
+        started[t] = t > 0 && pthread_create(&tid[t], NULL, run_job, &job[t]) == 0;
+    }
+
+    for (int t = 0; t < threads; t++)
+        if (!started[t]) run_job(&job[t]);
+
+    for (int t = 0; t < threads; t++)
+        if (started[t]) pthread_join(tid[t], NULL);
+}
+
+static char *read_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    size_t cap = 4096, len = 0;
+    char *data = malloc(cap + 1);
+    size_t n;
+
+    while (data && (n = fread(data + len, 1, cap - len, f)) > 0) {
+        len += n;
+        if (len == cap) {
+            cap *= 2;
+            char *grown = realloc(data, cap + 1);
+            if (!grown) free(data);
+            data = grown;
+        }
+    }
+
+    if (data && ferror(f)) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+
+    if (data) {
+        data[len] = '\0';
+        *size = len;
+    }
+    return data;
+}
+
+static int split_lines(char *text, size_t size, const char **out, int max) {
+    int count = 0;
+    char *p = text, *end = text + size;
+
+    while (p < end) {
+        char *nl = memchr(p, '\n', end - p);
+        char *stop = nl ? nl : end;
+        if (stop > p && stop[-1] == '\r') stop--;
+        if (out) *stop = '\0';
+        if (count < max) out[count] = p;
+        count++;
+        p = nl ? nl + 1 : end;
+    }
+
+    return count;
+}
+
+static int name_cmp(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int load_directory(const char *path) {
+    DIR *dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "ghost-pack: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    size_t count = 0, cap = 0;
+    char **names = NULL;
+    struct dirent *ent;
+
+    while ((ent = readdir(dir))) {
+        if (ent->d_name[0] == '.') continue;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 256;
+            names = realloc(names, cap * sizeof(*names));
+            if (!names) {
+                closedir(dir);
+                return -1;
+            }
+        }
+        names[count++] = strdup(ent->d_name);
+    }
+    closedir(dir);
+
+    if (count == 0) {
+        fprintf(stderr, "ghost-pack: %s: no frames\n", path);
+        return -1;
+    }
+    qsort(names, count, sizeof(*names), name_cmp);
+
+    input.frame_count = count;
+    input.height = 0;
+
+    for (size_t f = 0; f < count; f++) {
+        char file[4096];
+        size_t size;
+        snprintf(file, sizeof(file), "%s/%s", path, names[f]);
+
+        char *text = read_file(file, &size);
+        if (!text) {
+            fprintf(stderr, "ghost-pack: %s: %s\n", file, strerror(errno));
+            return -1;
+        }
+
+        if (f == 0) {
+            input.height = split_lines(text, size, NULL, 0);
+            if (input.height == 0 || input.height > PACK_HEIGHT_MAX) {
+                fprintf(stderr, "ghost-pack: %s: bad frame height %d\n",
+                    file, input.height);
+                return -1;
+            }
+            input.lines = malloc(count * input.height * sizeof(char *));
+            if (!input.lines) return -1;
+        }
+
+        int height = split_lines(text, size, input.lines + f * input.height,
+            input.height);
+        if (height != input.height) {
+            fprintf(stderr, "ghost-pack: %s: %d rows, expected %d\n",
+                file, height, input.height);
+            return -1;
+        }
+        free(names[f]);
+    }
+
+    free(names);
+    return 0;
+}
+
+static int load_builtin(void) {
+    input.frame_count = FRAME_COUNT;
+    input.height = IMAGE_HEIGHT;
+    input.lines = malloc(FRAME_COUNT * IMAGE_HEIGHT * sizeof(char *));
+    if (!input.lines) return -1;
+
+    for (int f = 0; f < FRAME_COUNT; f++)
+        for (int r = 0; r < IMAGE_HEIGHT; r++)
+            input.lines[f * IMAGE_HEIGHT + r] = animation_row(f, r);
+    return 0;
+}
+
+static size_t format_row(const char *line, char *output, int *columns) {
+    char *start = output;
+    int cols = 0;
+
+    while (*line) {
+        if (strncmp(line, "<color>", 7) == 0) {
+            memcpy(output, COLOR_BLUE, strlen(COLOR_BLUE));
+            output += strlen(COLOR_BLUE);
+            line += 7;
+        } else if (strncmp(line, "</color>", 8) == 0) {
+            memcpy(output, COLOR_RESET, strlen(COLOR_RESET));
+            output += strlen(COLOR_RESET);
+            line += 8;
+        } else {
+            uint32_t cp;
+            size_t n = utf8_decode(line, line + 4, &cp);
+            cols += char_width(cp);
+            memcpy(output, line, n);
+            output += n;
+            line += n;
+        }
+
+        if (output - start > PACK_ROW_MAX) return (size_t)-1;
+    }
+
+    *columns = cols;
+    return output - start;
+}
+
+static void format_job(size_t i, void *arg) {
+    int *widths = arg;
+    char row[PACK_ROW_MAX + 16];
+
+    size_t len = format_row(input.lines[i], row, &widths[i]);
+    formatted_len[i] = len;
+    if (len == (size_t)-1) return;
+
+    formatted[i] = malloc(len ? len : 1);
+    if (formatted[i]) memcpy(formatted[i], row, len);
+}
+
+static int format_pass(void) {
+    size_t total = input.frame_count * input.height;
+    int *widths = calloc(total, sizeof(int));
+
+    formatted = calloc(total, sizeof(char *));
+    formatted_len = calloc(total, sizeof(size_t));
+    if (!widths || !formatted || !formatted_len) return -1;
+
+    parallel_for(total, format_job, widths);
+
+    for (size_t i = 0; i < total; i++) {
+        if (formatted_len[i] == (size_t)-1) {
+            fprintf(stderr, "ghost-pack: frame %zu row %zu longer than %d bytes\n",
+                i / input.height, i % input.height, PACK_ROW_MAX);
+            return -1;
+        }
+        if (!formatted[i]) return -1;
+        if (widths[i] > width) width = widths[i];
+    }
+
+    free(widths);
+    return 0;
+}
+
+static uint32_t hash_row(const char *data, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (uint8_t)data[i]) * 16777619u;
+    return h;
+}
+
+static int intern_pass(void) {
+    size_t total = input.frame_count * input.height;
+    size_t slots = 1;
+    while (slots < total * 2) slots <<= 1;
+
+    uint32_t *table = malloc(slots * sizeof(uint32_t));
+    ids = malloc(total * sizeof(uint16_t));
+    rows = calloc(total, sizeof(struct row));
+    if (!table || !ids || !rows) return -1;
+    memset(table, 0xff, slots * sizeof(uint32_t));
+
+    for (size_t i = 0; i < total; i++) {
+        size_t slot = hash_row(formatted[i], formatted_len[i]) & (slots - 1);
+
+        while (table[slot] != UINT32_MAX) {
+            struct row *r = &rows[table[slot]];
+            if (r->len == formatted_len[i] &&
+                memcmp(r->data, formatted[i], r->len) == 0)
+                break;
+            slot = (slot + 1) & (slots - 1);
+        }
+
+        if (table[slot] == UINT32_MAX) {
+            if (row_count >= PACK_NO_REF) {
+                fprintf(stderr, "ghost-pack: more than %d unique rows\n",
+                    PACK_NO_REF - 1);
+                free(table);
+                return -1;
+            }
+            rows[row_count] = (struct row){
+                .data = formatted[i], .len = formatted_len[i],
+                .first = (uint32_t)i, .ref = PACK_NO_REF
+            };
+            table[slot] = (uint32_t)row_count++;
+        }
+
+        ids[i] = (uint16_t)table[slot];
+    }
+
+    free(table);
+    return 0;
+}
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = v >> (8 * i) & 0xff;
+}
+
+static size_t delta_pass(uint8_t **out, uint32_t *index) {
+    int h = input.height;
+    size_t mask_size = ((size_t)h + 7) / 8;
+    size_t cap = input.frame_count * (1 + mask_size + 2 * (size_t)h);
+    uint8_t *buf = malloc(cap);
+    size_t len = 0;
+    if (!buf) return 0;
+
+    for (size_t f = 0; f < input.frame_count; f++) {
+        const uint16_t *cur = ids + f * h;
+        const uint16_t *prev = cur - h;
+
+        if (f % keyframe_interval == 0) {
+            index[f / keyframe_interval] = (uint32_t)len;
+            buf[len++] = PACK_FRAME_KEY;
+            for (int r = 0; r < h; r++, len += 2) put16(buf + len, cur[r]);
+            continue;
+        }
+
+        buf[len++] = PACK_FRAME_DELTA;
+        uint8_t *mask = buf + len;
+        memset(mask, 0, mask_size);
+        len += mask_size;
+
+        for (int r = 0; r < h; r++) {
+            if (cur[r] == prev[r]) continue;
+            mask[r >> 3] |= 1 << (r & 7);
+            put16(buf + len, cur[r]);
+            len += 2;
+        }
+    }
+
+    *out = buf;
+    return len;
+}
+
+static size_t lz_encode(const char *ref, size_t ref_len,
+                        const char *src, size_t len, uint8_t *out) {
+    char window[PACK_ROW_BUF];
+    size_t end = ref_len + len, pos = ref_len, anchor = ref_len, n = 0;
+
+    memcpy(window, ref, ref_len);
+    memcpy(window + ref_len, src, len);
+
+    while (pos <= end) {
+        size_t best = 0, offset = 0;
+
+        if (pos < end) {
+            size_t from = pos > PACK_MAX_OFFSET ? pos - PACK_MAX_OFFSET : 0;
+            for (size_t j = from; j < pos; j++) {
+                size_t k = 0;
+                while (pos + k < end && window[j + k] == window[pos + k]) k++;
+                if (k > best) {
+                    best = k;
+                    offset = pos - j;
+                }
+            }
+        }
+
+        if (pos < end && best < PACK_MIN_MATCH) {
+            pos++;
+            continue;
+        }
+
+        size_t lit = pos - anchor;
+        if (pos == end && lit == 0) break;
+
+        size_t match = best ? best - PACK_MIN_MATCH : 0;
+        out[n++] = (uint8_t)((lit < 15 ? lit : 15) << 4 | (match < 15 ? match : 15));
+        if (lit >= 15) {
+            size_t rem = lit - 15;
+            for (; rem >= 255; rem -= 255) out[n++] = 255;
+            out[n++] = (uint8_t)rem;
+        }
+        memcpy(out + n, window + anchor, lit);
+        n += lit;
+
+        if (pos == end) break;
+
+        out[n++] = (uint8_t)offset;
+        if (match >= 15) {
+            size_t rem = match - 15;
+            for (; rem >= 255; rem -= 255) out[n++] = 255;
+            out[n++] = (uint8_t)rem;
+        }
+        pos += best;
+        anchor = pos;
+    }
+
+    return n;
+}
+
+static uint16_t candidate(const struct row *r, int c) {
+    size_t h = input.height;
+    size_t f = r->first / h, i = r->first % h;
+
+    switch (c) {
+    case 1: return f ? ids[r->first - h] : PACK_NO_REF;
+    case 2: return i ? ids[r->first - 1] : PACK_NO_REF;
+    case 3: return f && i ? ids[r->first - h - 1] : PACK_NO_REF;
+    }
+    return PACK_NO_REF;
+}
+
+static void cost_job(size_t i, void *arg) {
+    struct row *r = &rows[i];
+    uint8_t buf[PACK_ROW_BUF * 2];
+    (void)arg;
+
+    r->cost[0] = lz_encode("", 0, r->data, r->len, buf);
+    for (int c = 1; c <= CANDIDATES; c++) {
+        uint16_t ref = candidate(r, c);
+        r->cost[c] = ref == PACK_NO_REF ? SIZE_MAX :
+            lz_encode(rows[ref].data, rows[ref].len, r->data, r->len, buf);
+    }
+}
+
+static void encode_job(size_t i, void *arg) {
+    struct row *r = &rows[i];
+    uint8_t buf[PACK_ROW_BUF * 2];
+    (void)arg;
+
+    size_t n = r->ref == PACK_NO_REF ?
+        lz_encode("", 0, r->data, r->len, buf) :
+        lz_encode(rows[r->ref].data, rows[r->ref].len, r->data, r->len, buf);
+
+    r->enc = malloc(n + 2);
+    if (!r->enc) return;
+    put16(r->enc, r->ref);
+    memcpy(r->enc + 2, buf, n);
+    r->enc_len = n + 2;
+}
+
+static int compress_pass(void) {
+    parallel_for(row_count, cost_job, NULL);
+
+    for (size_t i = 0; i < row_count; i++) {
+        struct row *r = &rows[i];
+        size_t best = r->cost[0];
+
+        for (int c = 1; c <= CANDIDATES; c++) {
+            uint16_t ref = candidate(r, c);
+            if (ref == PACK_NO_REF || rows[ref].depth >= PACK_REF_DEPTH) continue;
+            if (r->cost[c] < best) {
+                best = r->cost[c];
+                r->ref = ref;
+                r->depth = rows[ref].depth + 1;
+            }
+        }
+    }
+
+    parallel_for(row_count, encode_job, NULL);
+
+    for (size_t i = 0; i < row_count; i++)
+        if (!rows[i].enc) return -1;
+    return 0;
+}
+
+static size_t keyframe_count(void) {
+    return (input.frame_count - 1) / keyframe_interval + 1;
+}
+
+static uint8_t *build_pack(int compressed, const uint8_t *frames,
+                           size_t frames_size, const uint32_t *index,
+                           size_t *size) {
+    size_t rows_size = 0;
+    for (size_t i = 0; i < row_count; i++)
+        rows_size += compressed ? rows[i].enc_len : rows[i].len;
+
+    size_t rows_offset = PACK_HEADER_SIZE;
+    size_t data_offset = rows_offset + 4 * (row_count + 1);
+    size_t frames_offset = data_offset + rows_size;
+    size_t index_offset = frames_offset + frames_size;
+    size_t total = index_offset + 4 * keyframe_count();
+
+    uint8_t *pack = malloc(total);
+    if (!pack) return NULL;
+
+    memcpy(pack, PACK_MAGIC, 4);
+    put16(pack + 4, PACK_VERSION);
+    put16(pack + 6, compressed ? PACK_COMPRESSED : 0);
+    put16(pack + 8, (uint16_t)width);
+    put16(pack + 10, (uint16_t)input.height);
+    put32(pack + 12, (uint32_t)input.frame_count);
+    put32(pack + 16, (uint32_t)row_count);
+    put32(pack + 20, (uint32_t)rows_offset);
+    put32(pack + 24, (uint32_t)frames_offset);
+    put32(pack + 28, (uint32_t)frames_size);
+    put16(pack + 32, (uint16_t)keyframe_interval);
+    put16(pack + 34, 0);
+    put32(pack + 36, (uint32_t)index_offset);
+
+    size_t off = 0;
+    for (size_t i = 0; i < row_count; i++) {
+        const void *data = compressed ? (const void *)rows[i].enc : rows[i].data;
+        size_t len = compressed ? rows[i].enc_len : rows[i].len;
+
+        put32(pack + rows_offset + 4 * i, (uint32_t)off);
+        memcpy(pack + data_offset + off, data, len);
+        off += len;
+    }
+    put32(pack + rows_offset + 4 * row_count, (uint32_t)off);
+    memcpy(pack + frames_offset, frames, frames_size);
+    for (size_t k = 0; k < keyframe_count(); k++)
+        put32(pack + index_offset + 4 * k, index[k]);
+
+    *size = total;
+    return pack;
+}
+
+static int verify_pack(const uint8_t *data, size_t size, int reps,
+                       double *avg_us, double *max_us) {
+    struct pack pack;
+    struct pack_cursor cursor;
+    char row[PACK_ROW_BUF];
+    long long worst = 0, start = get_microseconds();
+
+    if (pack_open(&pack, data, size) != 0) return -1;
+    pack_rewind(&cursor, &pack);
+
+    for (int rep = 0; rep < reps; rep++) {
+        for (size_t f = 0; f < pack.frame_count; f++) {
+            long long t = get_microseconds();
+            if (pack_next(&cursor) != (int)f) return -1;
+
+            for (int r = 0; r < pack.height; r++) {
+                size_t i = f * pack.height + r;
+                int len = pack_row(&pack, cursor.ids[r], row);
+                if (len < 0 || (size_t)len != formatted_len[i] ||
+                    memcmp(row, formatted[i], len) != 0)
+                    return -1;
+            }
+
+            long long dt = get_microseconds() - t;
+            if (dt > worst) worst = dt;
+        }
+    }
+
+    *avg_us = (double)(get_microseconds() - start) / (reps * pack.frame_count);
+    *max_us = (double)worst;
+    return 0;
+}
+
+static int write_pack(const char *path, const uint8_t *pack, size_t size,
+                      const char *symbol) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+
+    if (!symbol) {
+        fwrite(pack, 1, size, f);
+    } else {
+        fprintf(f, "/* Generated by ghost-pack, do not edit. */\n\n");
+        fprintf(f, "const unsigned char %s[] = {", symbol);
+        for (size_t i = 0; i < size; i++)
+            fprintf(f, "%s0x%02x,", i % 16 ? " " : "\n    ", pack[i]);
+        fprintf(f, "\n};\n\nconst unsigned int %s_size = sizeof(%s);\n",
+            symbol, symbol);
+    }
+
+    int failed = ferror(f);
+    return fclose(f) != 0 || failed ? -1 : 0;
+}
+
+/*
+ * Write the frames as the C source of src/frames.c: each distinct row once,
+ * NUL-terminated, in one string, and a table of 32-bit offsets into it for
+ * every row of every frame, so the data needs no relocations and sits in
+ * one read-only array.
+ */
+static int write_table(const char *path) {
+    if (input.frame_count != FRAME_COUNT || input.height != IMAGE_HEIGHT) {
+        fprintf(stderr, "ghost-pack: frames.h expects %d frames of %d rows\n",
+            FRAME_COUNT, IMAGE_HEIGHT);
+        return -1;
+    }
+
+    size_t total = input.frame_count * input.height, slots = 1, offset = 0;
+    size_t commented = (size_t)-1;
+    while (slots < 2 * total) slots <<= 1;
+
+    uint32_t *offsets = malloc(total * sizeof(uint32_t));
+    size_t *seen = calloc(slots, sizeof(size_t));
+    FILE *f = offsets && seen ? fopen(path, "w") : NULL;
+    if (!f) {
+        free(offsets);
+        free(seen);
+        return -1;
+    }
+
+    fprintf(f, "/* Generated by ghost-pack -t, edit the frames and generate it again. */\n\n");
+    fprintf(f, "#include \"include/frames.h\"\n\nconst char animation_text[] =");
+
+    for (size_t i = 0; i < total; i++) {
+        const char *line = input.lines[i];
+        size_t len = strlen(line), h = hash_row(line, len) & (slots - 1);
+
+        while (seen[h] && strcmp(input.lines[seen[h] - 1], line) != 0)
+            h = (h + 1) & (slots - 1);
+        if (seen[h]) {
+            offsets[i] = offsets[seen[h] - 1];
+            continue;
+        }
+        seen[h] = i + 1;
+        offsets[i] = (uint32_t)offset;
+        offset += len + 1;
+
+        /* Rows are listed under the frame they first appear in. */
+        if (i / input.height != commented) {
+            commented = i / input.height;
+            fprintf(f, "\n    /* frame %zu */", commented);
+        }
+        fputs("\n    \"", f);
+        for (const unsigned char *c = (const unsigned char *)line; *c; c++) {
+            if (*c == '"' || *c == '\\') fprintf(f, "\\%c", *c);
+            else if (*c < 0x20 || *c == 0x7f) fprintf(f, "\\%03o", *c);
+            else fputc(*c, f);
+        }
+        fputs("\\0\"", f);
+    }
+
+    fprintf(f, ";\n\nconst uint32_t animation_rows[FRAME_COUNT][IMAGE_HEIGHT] = {");
+    for (size_t i = 0; i < total; i++) {
+        if (i % input.height == 0) fprintf(f, "%s\n    {", i ? "\n    }," : "");
+        fprintf(f, "%s%u,", i % input.height % 8 ? " " : "\n        ", offsets[i]);
+    }
+    fprintf(f, "\n    },\n};\n");
+
+    free(offsets);
+    free(seen);
+    int failed = ferror(f) || offset > UINT32_MAX;
+    return fclose(f) != 0 || failed ? -1 : 0;
+}
+
+static int time_seek(const uint8_t *data, size_t size, int reps,
+                     double *avg_us, double *max_us) {
+    struct pack pack;
+    struct pack_cursor cursor;
+    char row[PACK_ROW_BUF];
+    long long worst = 0, start = get_microseconds();
+
+    if (pack_open(&pack, data, size) != 0) return -1;
+    pack_rewind(&cursor, &pack);
+
+    for (int rep = 0; rep < reps; rep++) {
+        for (size_t i = 0; i < pack.frame_count; i++) {
+            uint32_t f = (uint32_t)(i * 7919 % pack.frame_count);
+            long long t = get_microseconds();
+
+            if (pack_seek(&cursor, f) != 0 || pack_next(&cursor) != (int)f)
+                return -1;
+            for (int r = 0; r < pack.height; r++)
+                if (pack_row(&pack, cursor.ids[r], row) < 0) return -1;
+
+            long long dt = get_microseconds() - t;
+            if (dt > worst) worst = dt;
+        }
+    }
+
+    *avg_us = (double)(get_microseconds() - start) / (reps * pack.frame_count);
+    *max_us = (double)worst;
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: ghost-pack [-z] [-j jobs] [-k interval] [-r reps] [-c symbol]\n"
+        "                  -o out.pack (-b | frames-dir)\n"
+        "       ghost-pack -t -o frames.c (-b | frames-dir)\n"
+        "\n"
+        "  -b        pack the built-in animation instead of a directory\n"
+        "  -z        compress interned rows\n"
+        "  -j jobs   worker threads (default: online cpus)\n"
+        "  -k n      keyframe every n frames (default: %d)\n"
+        "  -r reps   decode passes used for the timing statistics\n"
+        "  -c symbol write the pack as C source defining symbol[] and symbol_size\n"
+        "  -t        write the frames as the string table of src/frames.c instead\n"
+        "            of packing them\n"
+        "  -o file   output pack\n", PACK_KEYFRAME_INTERVAL);
+}
+
+int main(int argc, char **argv) {
+    const char *output = NULL, *symbol = NULL;
+    int builtin = 0, compressed = 0, table = 0, reps = 10, opt;
+
+    jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    while ((opt = getopt(argc, argv, "bztj:k:r:c:o:h")) != -1) {
+        switch (opt) {
+        case 'b': builtin = 1; break;
+        case 'z': compressed = 1; break;
+        case 't': table = 1; break;
+        case 'j': jobs = atoi(optarg); break;
+        case 'k': keyframe_interval = atoi(optarg); break;
+        case 'r': reps = atoi(optarg); break;
+        case 'c': symbol = optarg; break;
+        case 'o': output = optarg; break;
+        default:
+            usage();
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (!output || builtin == (optind < argc) || reps < 1 ||
+        keyframe_interval < 1 || keyframe_interval > UINT16_MAX) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    if (jobs < 1) jobs = 1;
+
+    long long t = get_microseconds();
+    if ((builtin ? load_builtin() : load_directory(argv[optind])) != 0)
+        return EXIT_FAILURE;
+
+    size_t total = input.frame_count * input.height, input_bytes = 0;
+    for (size_t i = 0; i < total; i++) input_bytes += strlen(input.lines[i]);
+    printf("%-10s %10zu bytes %9.2f ms  %zu frames x %d rows, %d threads\n",
+        "load", input_bytes, elapsed_ms(t), input.frame_count, input.height, jobs);
+
+    if (table) {
+        if (write_table(output) != 0) {
+            fprintf(stderr, "ghost-pack: %s: cannot write the frame table\n", output);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    t = get_microseconds();
+    if (format_pass() != 0) return EXIT_FAILURE;
+    size_t formatted_bytes = 0;
+    for (size_t i = 0; i < total; i++) formatted_bytes += formatted_len[i];
+    printf("%-10s %10zu bytes %9.2f ms  %d columns\n",
+        "format", formatted_bytes, elapsed_ms(t), width);
+
+    t = get_microseconds();
+    if (intern_pass() != 0) return EXIT_FAILURE;
+    size_t interned_bytes = 0;
+    for (size_t i = 0; i < row_count; i++) interned_bytes += rows[i].len;
+    printf("%-10s %10zu bytes %9.2f ms  %zu unique of %zu rows\n",
+        "intern", interned_bytes, elapsed_ms(t), row_count, total);
+
+    t = get_microseconds();
+    uint8_t *frames;
+    uint32_t *index = malloc(keyframe_count() * sizeof(uint32_t));
+    size_t frames_size = index ? delta_pass(&frames, index) : 0;
+    if (frames_size == 0) return EXIT_FAILURE;
+    printf("%-10s %10zu bytes %9.2f ms  %zu keyframes, full id tables: %zu bytes\n",
+        "delta", frames_size, elapsed_ms(t), keyframe_count(), total * 2);
+
+    if (compressed) {
+        t = get_microseconds();
+        if (compress_pass() != 0) return EXIT_FAILURE;
+        size_t compressed_bytes = 0;
+        for (size_t i = 0; i < row_count; i++) compressed_bytes += rows[i].enc_len;
+        printf("%-10s %10zu bytes %9.2f ms  %.1f%% of interned rows\n",
+            "compress", compressed_bytes, elapsed_ms(t),
+            100.0 * compressed_bytes / (interned_bytes ? interned_bytes : 1));
+    }
+
+    size_t size;
+    uint8_t *pack = build_pack(compressed, frames, frames_size, index, &size);
+    if (!pack) return EXIT_FAILURE;
+
+    double avg_us, max_us;
+    if (verify_pack(pack, size, reps, &avg_us, &max_us) != 0) {
+        fprintf(stderr, "ghost-pack: round-trip verification failed\n");
+        return EXIT_FAILURE;
+    }
+    printf("%-10s %10zu bytes %9.2f us/frame avg, %.0f us max\n",
+        "decode", size, avg_us, max_us);
+
+    if (time_seek(pack, size, reps, &avg_us, &max_us) != 0) {
+        fprintf(stderr, "ghost-pack: seek verification failed\n");
+        return EXIT_FAILURE;
+    }
+    printf("%-10s %10s       %9.2f us/seek avg, %.0f us max\n",
+        "seek", "", avg_us, max_us);
+
+    if (write_pack(output, pack, size, symbol) != 0) {
+        fprintf(stderr, "ghost-pack: %s: %s\n", output, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,243 @@
+#include <errno.h>
+#include <poll.h>
+#include <pty.h>
+#include <sys/wait.h>
+
+#include "include/ghost.h"
+#include "include/vt.h"
+
+#define LOOKAHEAD 8
+
+struct reference {
+    int rows, cols;
+    int top, left, width;
+    struct vt_cell *cells;
+};
+
+static int parse_geometry(const char *s, int *cols, int *rows) {
+    char x;
+    return sscanf(s, "%d%c%d", cols, &x, rows) == 3 && (x == 'x' || x == 'X') &&
+        *cols > 0 && *rows > 0 ? 0 : -1;
+}
+
+static struct vt_cell *ref_frame(const struct reference *ref, size_t frame) {
+    return ref->cells + frame * IMAGE_HEIGHT * ref->width;
+}
+
+static void snapshot(const struct vt *vt, const struct reference *ref,
+                     struct vt_cell *out) {
+    for (int i = 0; i < IMAGE_HEIGHT; i++)
+        memcpy(out + i * ref->width, vt_cell(vt, ref->top + i, ref->left),
+            ref->width * sizeof(struct vt_cell));
+}
+
+static int build_reference(struct reference *ref, int rows, int cols) {
+    struct vt vt;
+
+    term_rows = rows;
+    term_cols = cols;
+    center_image();
+
+    ref->rows = rows;
+    ref->cols = cols;
+    ref->top = start_row - 1;
+    ref->left = start_col;
+    ref->width = cols - start_col < IMAGE_WIDTH ? cols - start_col : IMAGE_WIDTH;
+    ref->cells = malloc((size_t)FRAME_COUNT * IMAGE_HEIGHT * ref->width *
+        sizeof(struct vt_cell));
+
+    if (!ref->cells || load_frames() != 0 || alloc_buffers() != 0 ||
+        vt_init(&vt, rows, cols) != 0)
+        return -1;
+
+    for (size_t f = 0; f < FRAME_COUNT; f++) {
+        const struct frame_slot *frame = get_frame(f);
+        if (!frame) return -1;
+        compose_frame(frame);
+        vt_feed(&vt, output, encode_frame(output));
+        snapshot(&vt, ref, ref_frame(ref, f));
+    }
+
+    vt_free(&vt);
+    return 0;
+}
+
+static int same_screen(const struct vt_cell *a, const struct vt_cell *b, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        if (a[i].ch != b[i].ch || (a[i].ch != ' ' && a[i].fg != b[i].fg))
+            return 0;
+    return 1;
+}
+
+static int match(const struct vt *vt, const struct reference *ref, long last,
+                 struct vt_cell *scratch) {
+    snapshot(vt, ref, scratch);
+    size_t n = (size_t)IMAGE_HEIGHT * ref->width;
+
+    if (last < 0) {
+        for (size_t f = 0; f < FRAME_COUNT; f++)
+            if (same_screen(scratch, ref_frame(ref, f), n)) return (int)f;
+        return -1;
+    }
+
+    for (long k = 1; k <= LOOKAHEAD; k++) {
+        long f = (last + k) % FRAME_COUNT;
+        if (same_screen(scratch, ref_frame(ref, f), n)) return (int)f;
+    }
+    return -1;
+}
+
+static void usage_pty(void) {
+    fprintf(stderr,
+        "usage: ghost-pty [-d seconds] [-g COLSxROWS] [-r COLSxROWS] ghost [args...]\n"
+        "\n"
+        "  -d seconds   how long to play before sending 'q' (default: 5)\n"
+        "  -g geometry  initial pty size (default: 115x56)\n"
+        "  -r geometry  resize to this size halfway through (default: 140x70)\n");
+}
+
+int main(int argc, char **argv) {
+    double duration = 5;
+    int cols = 115, rows = 56, resize_cols = 140, resize_rows = 70, opt;
+
+    while ((opt = getopt(argc, argv, "+d:g:r:h")) != -1) {
+        switch (opt) {
+        case 'd': duration = atof(optarg); break;
+        case 'g':
+            if (parse_geometry(optarg, &cols, &rows) != 0) {
+                usage_pty();
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'r':
+            if (parse_geometry(optarg, &resize_cols, &resize_rows) != 0) {
+                usage_pty();
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            usage_pty();
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (optind >= argc || duration <= 0) {
+        usage_pty();
+        return EXIT_FAILURE;
+    }
+
+    struct reference refs[2];
+    if (build_reference(&refs[0], rows, cols) != 0 ||
+        build_reference(&refs[1], resize_rows, resize_cols) != 0) {
+        fprintf(stderr, "ghost-pty: cannot render reference frames\n");
+        return EXIT_FAILURE;
+    }
+    struct vt_cell *scratch = malloc((size_t)IMAGE_HEIGHT * IMAGE_WIDTH * sizeof(struct vt_cell));
+
+    struct vt vt;
+    struct winsize ws = {.ws_row = rows, .ws_col = cols};
+    int master;
+
+    if (!scratch || vt_init(&vt, rows, cols) != 0) return EXIT_FAILURE;
+
+    long long spawned = get_nanoseconds();
+    pid_t pid = forkpty(&master, NULL, NULL, &ws);
+    if (pid < 0) {
+        fprintf(stderr, "ghost-pty: forkpty: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (pid == 0) {
+        execv(argv[optind], argv + optind);
+        _exit(127);
+    }
+
+    struct histogram latency = {0};
+    const struct reference *ref = &refs[0];
+    long long anchor = -1, first = -1, resize_at = -1, resized_seen = -1;
+    long long quit_at = -1, exited = -1;
+    long long end = get_nanoseconds() + (long long)(duration * 1e9);
+    long last = -1, last_tick = -1, offset = 0;
+    unsigned long long bytes = 0, frames = 0, missed = 0;
+    char buf[65536];
+    int status = 0;
+
+    for (;;) {
+        long long now = get_nanoseconds();
+
+        if (resize_at < 0 && anchor >= 0 && now >= anchor + (end - anchor) / 2) {
+            struct winsize big = {.ws_row = resize_rows, .ws_col = resize_cols};
+            vt_free(&vt);
+            if (vt_init(&vt, resize_rows, resize_cols) != 0) return EXIT_FAILURE;
+            ioctl(master, TIOCSWINSZ, &big);
+            ref = &refs[1];
+            resize_at = now;
+        }
+
+        if (quit_at < 0 && now >= end) {
+            write(master, "q", 1);
+            quit_at = now;
+        }
+
+        struct pollfd pfd = {master, POLLIN, 0};
+        int ready = poll(&pfd, 1, 5);
+        if (ready < 0 && errno != EINTR) break;
+        if (ready <= 0) continue;
+
+        ssize_t n = read(master, buf, sizeof(buf));
+        now = get_nanoseconds();
+        if (n <= 0) break;
+
+        if (anchor < 0) anchor = now;
+        bytes += (unsigned long long)n;
+        vt_feed(&vt, buf, (size_t)n);
+
+        int f = match(&vt, ref, last, scratch);
+        if (f < 0) continue;
+
+        if (first < 0) offset = f;
+
+        long long tick = (now - anchor + MICROS_PER_FRAME * 500LL) / (MICROS_PER_FRAME * 1000LL);
+        tick -= ((tick - f + offset) % FRAME_COUNT + FRAME_COUNT) % FRAME_COUNT;
+
+        long long late = now - anchor - tick * MICROS_PER_FRAME * 1000LL;
+        hist_record(&latency, late > 0 ? (unsigned long long)late : 0);
+
+        if (last_tick >= 0 && tick - last_tick > 1)
+            missed += (unsigned long long)(tick - last_tick - 1);
+        if (resize_at >= 0 && resized_seen < 0 && ref == &refs[1])
+            resized_seen = now;
+        if (first < 0) first = now;
+
+        frames++;
+        last = f;
+        last_tick = tick;
+    }
+
+    if (waitpid(pid, &status, 0) == pid) exited = get_nanoseconds();
+    close(master);
+
+    double seconds = first >= 0 ? (quit_at - first) / 1e9 : 0;
+
+    printf("%-10s %dx%d, resized to %dx%d, %.1f s\n", "geometry",
+        cols, rows, resize_cols, resize_rows, duration);
+    printf("%-10s %llu shown, %llu missed\n", "frames", frames, missed);
+    printf("%-10s p50 %.3f ms, p99 %.3f ms, max %.3f ms (deadline to readable)\n",
+        "latency", hist_percentile(&latency, 0.50) / 1e6,
+        hist_percentile(&latency, 0.99) / 1e6, latency.max / 1e6);
+    printf("%-10s %.0f bytes/s, %.0f bytes/frame\n", "throughput",
+        seconds > 0 ? bytes / seconds : 0, frames ? (double)bytes / frames : 0);
+    if (first >= 0)
+        printf("%-10s %.3f ms from fork to the first complete frame\n", "startup",
+            (first - spawned) / 1e6);
+    if (resized_seen >= 0)
+        printf("%-10s %.3f ms to the first correct frame\n", "resize",
+            (resized_seen - resize_at) / 1e6);
+    else
+        printf("%-10s no correct frame after resize\n", "resize");
+    if (exited >= 0 && quit_at >= 0)
+        printf("%-10s %.3f ms from 'q' to exit, status %d\n", "quit",
+            (exited - quit_at) / 1e6, WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+
+    return frames && resized_seen >= 0 && WIFEXITED(status) &&
+        WEXITSTATUS(status) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
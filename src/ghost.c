@@ -2,16 +2,33 @@
 #include "include/frames.h"
 
 struct termios orig_termios;
-volatile sig_atomic_t last_frame_index = 0;
+volatile sig_atomic_t last_frame_index = -1;
+volatile sig_atomic_t resized = 0;
+volatile sig_atomic_t quit_requested = 0;
+volatile sig_atomic_t stats_requested = 0;
+volatile sig_atomic_t suspend_requested = 0;
+volatile sig_atomic_t resumed = 0;
 
-char *buffer;
-char formatted_frames
-    [FRAME_COUNT]
-    [IMAGE_HEIGHT]
-    [MAX_LINE_LENGTH * 2];
+struct cell *buffer;
+struct cell *screen;
+char *output;
+size_t *line_length;
+size_t *screen_length;
+int rep_supported = 1;
+int show_stats;
+int interactive = 1;
+int overlay;
+int focused = 1;
+int overlay_row = 1, overlay_col = -1;
+
+static const struct cell blank = {' ', 0, 1};
+
+struct decoder decoder;
+long long frame_offset;
 
 int term_rows, term_cols;
 int start_row, start_col;
+int grid_rows = 1, grid_cols = 1, canvas_rows = IMAGE_HEIGHT;
 
 long long get_microseconds(void) {
     struct timespec ts;
@@ -26,47 +43,94 @@ void get_terminal_size(int *rows, int *cols) {
     *cols = w.ws_col;
 }
 
+static int raw_mode;
+
 void enable_raw_mode(void) {
-    tcgetattr(STDIN_FILENO, &orig_termios);
+    if (!raw_mode) tcgetattr(STDIN_FILENO, &orig_termios);
     struct termios raw = orig_termios;
     raw.c_lflag &= ~(ECHO | ICANON);
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+    raw_mode = 1;
 }
 
 void disable_raw_mode(void) {
+    if (!raw_mode) return;
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig_termios);
+    raw_mode = 0;
 }
 
 int kbhit(void) {
-    static struct termios oldt, newt;
-    tcgetattr(STDIN_FILENO, &oldt);
-    newt = oldt;
-    newt.c_lflag &= ~(ICANON | ECHO);
-    tcsetattr(STDIN_FILENO, TCSANOW, &newt);
+    return fdio_pending();
+}
 
-    int oldf = fcntl(STDIN_FILENO, F_GETFL, 0);
-    fcntl(STDIN_FILENO, F_SETFL, oldf | O_NONBLOCK);
+/*
+ * Handle every pending key, including the focus reports (CSI I and CSI O)
+ * enabled by prepare_terminal. Returns 1 when asked to quit.
+ */
+int read_input(void) {
+    while (fdio_pending()) {
+        int c = fdio_getc();
+        long long now = get_microseconds();
 
-    int ch = getchar();
+        if (c == 'q' || c == 'Q')
+            return 1;
+        else if (c == ' ')
+            timeline_pause(now);
+        else if (c == '.')
+            timeline_step(now, 1);
+        else if (c == ',')
+            timeline_step(now, -1);
+        else if (c == '>')
+            timeline_seek(now, SEEK_FRAMES);
+        else if (c == '<')
+            timeline_seek(now, -SEEK_FRAMES);
+        else if (c == '+' || c == '=')
+            timeline_speed(now, 2);
+        else if (c == '-')
+            timeline_speed(now, 0.5);
+        else if (c == 'r')
+            timeline_reverse(now);
+        else if (c == 'p')
+            timeline_pingpong(now);
+        else if (c == '\x1b' && fdio_getc() == '[') {
+            c = fdio_getc();
+            if (c == 'I') focused = 1;
+            else if (c == 'O') focused = 0;
+        }
+    }
+    return 0;
+}
 
-    tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
-    fcntl(STDIN_FILENO, F_SETFL, oldf);
+/*
+ * Block without a timeout until there is input to handle or a signal needs
+ * the main loop, as while unfocused or paused. The signals are held off
+ * between checking the flags and sleeping so that none of them is missed.
+ */
+void wait_for_input(void) {
+    sigset_t block, orig;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    sigaddset(&block, SIGWINCH);
+    sigaddset(&block, SIGTSTP);
+    sigaddset(&block, SIGCONT);
+    sigaddset(&block, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &block, &orig);
 
-    if (ch != EOF) {
-        ungetc(ch, stdin);
-        return EXIT_FAILURE;
+    if (!quit_requested && !resized && !suspend_requested && !resumed && !stats_requested) {
+        fd_set fds;
+        FD_ZERO(&fds);
+        if (interactive) FD_SET(STDIN_FILENO, &fds);
+        int ready = pselect(STDIN_FILENO + 1, &fds, NULL, NULL, NULL, &orig);
+        stats_wakeup();
+        if (ready > 0 && read_input())
+            quit_requested = 1;
     }
 
-    return EXIT_SUCCESS;
+    sigprocmask(SIG_SETMASK, &orig, NULL);
 }
 
-void move_cursor(int row, int col) {
-    static char buffer[16];
-    static int last_row = -1, last_col = -1;
-
-    if (row == last_row && col == last_col) return;
-
-    char *ptr = buffer;
+char *encode_cursor(char *ptr, int row, int col) {
     *ptr++ = '\x1b';
     *ptr++ = '[';
 
@@ -81,12 +145,7 @@ void move_cursor(int row, int col) {
     *ptr++ = '0' + (col % 10);
 
     *ptr++ = 'H';
-    *ptr = '\0';
-
-    write(STDOUT_FILENO, buffer, ptr - buffer);
-
-    last_row = row;
-    last_col = col;
+    return ptr;
 }
 
 void clear_line_to_end(void) {
@@ -95,155 +154,995 @@ void clear_line_to_end(void) {
 
 void update_dimensions(void) {
     get_terminal_size(&term_rows, &term_cols);
+    if (wall) wall_grid();
+    place_image();
+}
+
+int terminal_fits(void) {
+    if (overlay)
+        return term_cols >= IMAGE_WIDTH && term_rows >= IMAGE_HEIGHT;
+    if (wall && (canvas_width() > term_cols || canvas_rows > term_rows))
+        return 0;
+    return term_cols >= 115 && term_rows >= 56;
+}
+
+void set_grid(int rows, int cols) {
+    grid_rows = rows;
+    grid_cols = cols;
+    canvas_rows = rows * TILE_HEIGHT - (TILE_HEIGHT - IMAGE_HEIGHT);
+}
+
+int canvas_width(void) {
+    return grid_cols * TILE_WIDTH - (TILE_WIDTH - IMAGE_WIDTH);
+}
+
+void place_image(void) {
+    if (!overlay) {
+        center_image();
+        return;
+    }
+
+    start_row = overlay_row > 0 ? overlay_row : term_rows - IMAGE_HEIGHT + 2 + overlay_row;
+    start_col = overlay_col > 0 ? overlay_col - 1 : term_cols - IMAGE_WIDTH + 1 + overlay_col;
+
+    if (start_row < 1) start_row = 1;
+    if (start_col < 0) start_col = 0;
+}
 
-    start_row = (term_rows - IMAGE_HEIGHT) / 2;
-    start_col = (term_cols - IMAGE_WIDTH) / 2;
+void center_image(void) {
+    start_row = (term_rows - canvas_rows) / 2;
+    start_col = (term_cols - canvas_width()) / 2;
 
-    if (start_row < 0) start_row = 0;
+    if (start_row < 1) start_row = 1;
     if (start_col < 0) start_col = 0;
 }
 
 void clear_screen(void) {
     CSI(CLEAR_SCREEN);
     CSI(MOVE_CURSOR_HOME);
-    fflush(stdout);
+    fdio_flush();
 }
 
 void prepare_terminal(void) {
-    enable_raw_mode();
-    CSI(ALTERNATE_SCREEN);
-    CSI(CLEAR_SCREEN);
-    CSI(CURSOR_HIDE);
-    fflush(stdout);
+    if (interactive) {
+        enable_raw_mode();
+        CSI(FOCUS_EVENTS_ON);
+    }
+    if (!overlay) {
+        CSI(ALTERNATE_SCREEN);
+        CSI(CLEAR_SCREEN);
+        CSI(CURSOR_HIDE);
+    }
 }
 
 void restore_terminal(void) {
-    CSI(CURSOR_SHOW);
-    CSI(MAIN_SCREEN);
-    disable_raw_mode();
-    fflush(stdout);
+    if (interactive) CSI(FOCUS_EVENTS_OFF);
+    if (!overlay) {
+        CSI(CURSOR_SHOW);
+        CSI(MAIN_SCREEN);
+    }
+    fdio_flush();
+    if (interactive) disable_raw_mode();
+}
+
+int alloc_buffers(void) {
+    size_t cells = (size_t)canvas_rows * term_cols;
+
+    struct cell *lines = realloc(buffer, cells * sizeof(struct cell));
+    if (lines) buffer = lines;
+
+    struct cell *shown = realloc(screen, cells * sizeof(struct cell));
+    if (shown) screen = shown;
+
+    size_t *lengths = realloc(line_length, canvas_rows * sizeof(size_t));
+    if (lengths) line_length = lengths;
+
+    size_t *shown_lengths = realloc(screen_length, canvas_rows * sizeof(size_t));
+    if (shown_lengths) screen_length = shown_lengths;
+
+    char *encoded = realloc(output, OUTPUT_SIZE(canvas_rows, term_cols));
+    if (encoded) output = encoded;
+
+    if (!lines || !shown || !lengths || !shown_lengths || !encoded) return -1;
+    if (wall && wall_alloc() != 0) return -1;
+    if (pipeline && pipeline_alloc() != 0) return -1;
+
+    for (size_t i = 0; i < cells; i++) buffer[i] = blank;
+    memset(line_length, 0, canvas_rows * sizeof(size_t));
+    reset_screen();
+    return 0;
+}
+
+void reset_screen(void) {
+    memset(screen_length, 0, canvas_rows * sizeof(size_t));
+}
+
+/*
+ * Forget what the terminal shows, so that the next frame repaints every
+ * cell the player may have drawn. An overlay only owns the image's columns,
+ * so it cannot clear the screen and marks those cells unknown instead.
+ */
+void invalidate_screen(void) {
+    static const struct cell unknown = {CELL_CH_MAX, 0, 1};
+    int last = start_col + (int)pack.width;
+    if (last > term_cols) last = term_cols;
+
+    pipeline_drain();
+    if (!overlay) {
+        clear_screen();
+        reset_screen();
+    } else {
+        for (int i = 0; i < canvas_rows; i++) {
+            struct cell *have = screen + (size_t)i * term_cols;
+            for (int c = (int)screen_length[i]; c < start_col; c++) have[c] = blank;
+            for (int c = start_col; c < last; c++) have[c] = unknown;
+            if ((int)screen_length[i] < last) screen_length[i] = (size_t)last;
+        }
+    }
+    last_frame_index = -1;
 }
 
 void handle_resize(int sig) {
+    resized = 1;
+}
+
+void apply_resize(void) {
+    resized = 0;
+    pipeline_drain();
     update_dimensions();
 
-    if (term_cols < 115 || term_rows < 56) {
-        clear_screen();
+    if (!terminal_fits() || alloc_buffers() != 0) {
+        if (!overlay) clear_screen();
         restore_terminal();
-        disable_raw_mode();
         exit(EXIT_FAILURE);
     }
 
-    clear_screen();
+    if (!overlay) clear_screen();
+    record_resize(term_rows, term_cols);
     last_frame_index = -1;
 }
 
 void handle_sigint(int sig) {
-    for (int i = 0; i < IMAGE_HEIGHT; i++) {
-        move_cursor(start_row + i, 1);
-        clear_line_to_end();
-    }
+    quit_requested = 1;
+}
 
-    free(buffer);
+void handle_sigusr1(int sig) {
+    stats_requested = 1;
+}
+
+void handle_sigtstp(int sig) {
+    suspend_requested = 1;
+}
+
+void handle_sigcont(int sig) {
+    resumed = 1;
+}
+
+/*
+ * Give the terminal back as on exit, then stop for real. Execution resumes
+ * here after SIGCONT, or right away when the stop is discarded because the
+ * process group is orphaned.
+ */
+void suspend_self(void) {
+    suspend_requested = 0;
+    pipeline_drain();
+    if (overlay) fdio_write(output, encode_clear(output));
     restore_terminal();
-    exit(EXIT_SUCCESS);
-}
-
-void preformat_frames(void) {
-    for (size_t frame = 0; frame < FRAME_COUNT; frame++) {
-        for (int i = 0; i < IMAGE_HEIGHT; i++) {
-            const char *line = animation_frames[frame][i];
-            char *output = formatted_frames[frame][i];
-
-            while (*line) {
-                if (strncmp(line, "<color>", 7) == 0) {
-                    memcpy(output, COLOR_BLUE, strlen(COLOR_BLUE));
-                    output += strlen(COLOR_BLUE);
-                    line += 7;
-                } else if (strncmp(line, "</color>", 8) == 0) {
-                    memcpy(output, COLOR_RESET, strlen(COLOR_RESET));
-                    output += strlen(COLOR_RESET);
-                    line += 8;
-                } else {
-                    *output++ = *line++;
-                }
+
+    signal(SIGTSTP, SIG_DFL);
+    raise(SIGTSTP);
+    signal(SIGTSTP, handle_sigtstp);
+    resumed = 1;
+}
+
+/*
+ * After SIGCONT, whether from fg, bg or a plain kill -CONT, the terminal may
+ * have changed hands, modes and size, so set it up again and redraw.
+ */
+void resume_terminal(void) {
+    resumed = 0;
+    pipeline_drain();
+    interactive = isatty(STDIN_FILENO) && tcgetpgrp(STDIN_FILENO) == getpgrp();
+    focused = 1;
+    prepare_terminal();
+    fdio_flush();
+    resized = 1;
+}
+
+void compose_rows(const struct frame_slot *const *frames, int first, int last) {
+    for (int i = first; i < last; i++) {
+        struct cell *line = buffer + (size_t)i * term_cols;
+        const struct frame_slot *const *row_frames = frames + i / TILE_HEIGHT * grid_cols;
+        int r = i % TILE_HEIGHT, pos = start_col;
+
+        if (r >= IMAGE_HEIGHT) {
+            line_length[i] = 0;
+            continue;
+        }
+
+        for (int t = 0; t < grid_cols; t++) {
+            const struct frame_slot *frame = row_frames[t];
+            int col = start_col + t * TILE_WIDTH;
+            int max = term_cols - col;
+            if (t + 1 < grid_cols && max > TILE_WIDTH) max = TILE_WIDTH;
+
+            int len = frame->offset[r + 1] - frame->offset[r];
+            if (len > max) len = max > 0 ? max : 0;
+
+            if (pos < col) simd.fill(line + pos, blank, (size_t)(col - pos));
+            memcpy(line + col, frame->cells + frame->offset[r], len * sizeof(struct cell));
+            pos = col + len;
+            if (len > 0 && line[pos - 1].width == 2) line[pos - 1] = blank;
+        }
+
+        line_length[i] = pos;
+    }
+}
+
+void compose_frame(const struct frame_slot *frame) {
+    compose_rows(&frame, 0, canvas_rows);
+}
+
+static int same_cell(struct cell a, struct cell b) {
+    return a.ch == b.ch && (a.ch == ' ' || a.fg == b.fg);
+}
+
+static struct cell cell_at(const struct cell *line, size_t len, int col) {
+    return (size_t)col < len ? line[col] : blank;
+}
+
+static int digits(int n) {
+    int d = 1;
+    while (n >= 10) {
+        n /= 10;
+        d++;
+    }
+    return d;
+}
+
+static int csi_cost(int n) {
+    return n == 1 ? 3 : 3 + digits(n);
+}
+
+static char *encode_csi(char *ptr, int n, char final) {
+    *ptr++ = '\x1b';
+    *ptr++ = '[';
+    if (n != 1) {
+        char tmp[12];
+        int k = 0;
+        while (n) {
+            tmp[k++] = '0' + n % 10;
+            n /= 10;
+        }
+        while (k) *ptr++ = tmp[--k];
+    }
+    *ptr++ = final;
+    return ptr;
+}
+
+static int sgr_cost(int fg) {
+    return fg ? 3 + digits(fg) : 3;
+}
+
+static char *put_cell(struct encoder *e, char *ptr, struct cell c) {
+    if (c.ch != ' ' && c.fg != e->fg) {
+        ptr = c.fg ? encode_csi(ptr, c.fg, 'm') : encode_csi(ptr, 1, 'm');
+        e->fg = c.fg;
+    }
+
+    ptr = utf8_encode(ptr, c.ch);
+    e->col += c.width;
+    if (e->col >= term_cols) e->row = e->col = -1;
+    return ptr;
+}
+
+static int reprint_cost(const struct encoder *e, const struct cell *line,
+                        size_t len, int from, int to, int limit) {
+    int fg = e->fg, cost = 0;
+
+    for (int c = from; c < to && cost < limit;) {
+        struct cell cell = cell_at(line, len, c);
+        if ((overlay && cell.ch == ' ') || cell.width == 0 || c + cell.width > to)
+            return limit;
+        if (cell.ch != ' ' && cell.fg != fg) {
+            cost += sgr_cost(cell.fg);
+            fg = cell.fg;
+        }
+        cost += (int)utf8_length(cell.ch);
+        c += cell.width;
+    }
+
+    return cost;
+}
+
+enum { MOVE_NONE, MOVE_CR, MOVE_CUF, MOVE_CUB, MOVE_BS, MOVE_CHA, MOVE_CR_CUF, MOVE_REPRINT };
+
+static int horizontal_cost(const struct encoder *e, int from, int to,
+                           const struct cell *line, size_t len, int reprint,
+                           int *how) {
+    if (from == to) {
+        *how = MOVE_NONE;
+        return 0;
+    }
+
+    int best = csi_cost(to + 1), cost;
+    *how = MOVE_CHA;
+
+    if (to == 0) {
+        *how = MOVE_CR;
+        return 1;
+    }
+    if ((cost = 1 + csi_cost(to)) < best) {
+        best = cost;
+        *how = MOVE_CR_CUF;
+    }
+
+    if (to > from) {
+        if ((cost = csi_cost(to - from)) < best) {
+            best = cost;
+            *how = MOVE_CUF;
+        }
+        if (reprint && (cost = reprint_cost(e, line, len, from, to, best)) < best) {
+            best = cost;
+            *how = MOVE_REPRINT;
+        }
+    } else {
+        if ((cost = csi_cost(from - to)) < best) {
+            best = cost;
+            *how = MOVE_CUB;
+        }
+        if ((cost = from - to) < best) {
+            best = cost;
+            *how = MOVE_BS;
+        }
+    }
+
+    return best;
+}
+
+/*
+ * Move the cursor from where the last write left it to (row, col), 0-based,
+ * using whichever of CUP, a vertical move (CUD, CUU, VPA or CR + LFs) and a
+ * horizontal move (CR, CUF, CUB, backspaces, CHA, or reprinting the cells in
+ * between) is shortest in bytes, the way ncurses' mvcur prices its options.
+ */
+static char *encode_move(struct encoder *e, char *ptr, int row, int col,
+                         const struct cell *line, size_t len) {
+    if (e->row == row && e->col == col) return ptr;
+
+    int best = 4 + digits(row + 1) + digits(col + 1);
+    int vertical = -1, horizontal = MOVE_NONE;
+
+    if (e->row >= 0) {
+        int dr = row - e->row, how, cost;
+        int options[3][2] = {{0, e->col}, {0, e->col}, {0, 0}};
+
+        if (dr > 0) {
+            options[0][0] = csi_cost(dr);
+            options[2][0] = 1 + dr;
+        } else if (dr < 0) {
+            options[0][0] = csi_cost(-dr);
+        }
+        options[1][0] = dr ? csi_cost(row + 1) : -1;
+        if (dr <= 0) options[2][0] = -1;
+
+        for (int v = 0; v < 3; v++) {
+            if (options[v][0] < 0 || options[v][0] >= best) continue;
+            cost = options[v][0] + horizontal_cost(e, options[v][1], col, line,
+                len, dr == 0, &how);
+            if (cost < best) {
+                best = cost;
+                vertical = v;
+                horizontal = how;
             }
-            *output = '\0';
         }
     }
+
+    if (vertical < 0) {
+        ptr = encode_cursor(ptr, row + 1, col + 1);
+        e->row = row;
+        e->col = col;
+        return ptr;
+    }
+
+    int dr = row - e->row;
+    if (vertical == 0 && dr > 0) ptr = encode_csi(ptr, dr, 'B');
+    else if (vertical == 0 && dr < 0) ptr = encode_csi(ptr, -dr, 'A');
+    else if (vertical == 1) ptr = encode_csi(ptr, row + 1, 'd');
+    else if (vertical == 2) {
+        *ptr++ = '\r';
+        for (int i = 0; i < dr; i++) *ptr++ = '\n';
+        e->col = 0;
+    }
+    e->row = row;
+
+    switch (horizontal) {
+    case MOVE_CR: *ptr++ = '\r'; break;
+    case MOVE_CUF: ptr = encode_csi(ptr, col - e->col, 'C'); break;
+    case MOVE_CUB: ptr = encode_csi(ptr, e->col - col, 'D'); break;
+    case MOVE_BS: for (int c = col; c < e->col; c++) *ptr++ = '\b'; break;
+    case MOVE_CHA: ptr = encode_csi(ptr, col + 1, 'G'); break;
+    case MOVE_CR_CUF:
+        *ptr++ = '\r';
+        ptr = encode_csi(ptr, col, 'C');
+        break;
+    case MOVE_REPRINT:
+        for (int c = e->col; c < col;) {
+            struct cell cell = cell_at(line, len, c);
+            ptr = put_cell(e, ptr, cell);
+            c += cell.width;
+        }
+        break;
+    }
+
+    e->col = col;
+    return ptr;
+}
+
+static char *encode_row(struct encoder *e, char *ptr, const struct cell *cells,
+                        const size_t *lengths, int i) {
+    const struct cell *want = cells + (size_t)i * term_cols;
+    struct cell *have = screen + (size_t)i * term_cols;
+    size_t want_len = lengths[i], have_len = screen_length[i];
+    size_t common = want_len < have_len ? want_len : have_len;
+    int end = (int)(want_len > have_len ? want_len : have_len);
+    int row = start_row + i - 1;
+    int dirty = 0;
+
+    if (row >= term_rows) return ptr;
+
+    for (int c = 0; c < end;) {
+        /* Unchanged stretches are skipped a vector at a time. */
+        if ((size_t)c < common && want[c].ch == have[c].ch) {
+            c += (int)simd.same_prefix(want + c, have + c, common - (size_t)c);
+            if (c >= end) break;
+        }
+
+        struct cell w = cell_at(want, want_len, c);
+        if (same_cell(w, cell_at(have, have_len, c))) {
+            c++;
+            continue;
+        }
+        dirty = 1;
+        if (w.width == 0) w = cell_at(want, want_len, --c);
+
+        int run = 1, changed = 1;
+        while (c + run < end) {
+            struct cell next = cell_at(want, want_len, c + run);
+            if (next.ch != w.ch || (w.ch != ' ' && next.fg != w.fg)) break;
+            if (overlay && w.ch == ' ' && cell_at(have, have_len, c + run).ch == ' ')
+                break;
+            changed += !same_cell(next, cell_at(have, have_len, c + run));
+            run++;
+        }
+
+        ptr = encode_move(e, ptr, row, c, want, want_len);
+
+        if (w.ch == ' ') {
+            if (!overlay && c + run >= end && changed >= 3) {
+                memcpy(ptr, ERASE_LINE, sizeof(ERASE_LINE) - 1);
+                ptr += sizeof(ERASE_LINE) - 1;
+                break;
+            }
+            if (2 * csi_cost(run) < changed) {
+                ptr = encode_csi(ptr, run, 'X');
+                c += run;
+                continue;
+            }
+        }
+
+        int bytes = (int)utf8_length(w.ch);
+        ptr = put_cell(e, ptr, w);
+        if (rep_supported && run > 1 && csi_cost(run - 1) < (changed - 1) * bytes) {
+            ptr = encode_csi(ptr, run - 1, 'b');
+            e->col += run - 1;
+            if (e->col >= term_cols) e->row = e->col = -1;
+            c += run;
+            continue;
+        }
+        c += w.width;
+    }
+
+    if (dirty) {
+        memcpy(have, want, want_len * sizeof(struct cell));
+        screen_length[i] = want_len;
+    }
+    return ptr;
+}
+
+static char *encode_range(struct encoder *e, char *ptr, const struct cell *cells,
+                          const size_t *lengths, int first, int last) {
+    e->row = e->col = e->fg = -1;
+    for (int i = first; i < last; i++)
+        ptr = encode_row(e, ptr, cells, lengths, i);
+    return ptr;
+}
+
+char *encode_rows(struct encoder *e, char *ptr, int first, int last) {
+    return encode_range(e, ptr, buffer, line_length, first, last);
+}
+
+size_t encode_frame(char *out) {
+    return encode_canvas(out, buffer, line_length);
+}
+
+/* Encode a composed canvas other than buffer against the screen. */
+size_t encode_canvas(char *out, const struct cell *cells, const size_t *lengths) {
+    char *ptr = out;
+
+    if (overlay) {
+        memcpy(ptr, SAVE_CURSOR, sizeof(SAVE_CURSOR) - 1);
+        ptr += sizeof(SAVE_CURSOR) - 1;
+    }
+
+    struct encoder e;
+    char *body = ptr;
+    ptr = encode_range(&e, ptr, cells, lengths, 0, canvas_rows);
+
+    if (overlay) {
+        if (ptr == body) return 0;
+        memcpy(ptr, RESTORE_CURSOR, sizeof(RESTORE_CURSOR) - 1);
+        ptr += sizeof(RESTORE_CURSOR) - 1;
+    }
+
+    return ptr - out;
+}
+
+size_t encode_clear(char *out) {
+    memset(line_length, 0, canvas_rows * sizeof(size_t));
+    return encode_frame(out);
+}
+
+int load_frames(void) {
+    prefetch_stop();
+    if (frames_open() != 0) return -1;
+
+    decoder_reset(&decoder);
+    return 0;
+}
+
+int decode_next(void) {
+    return decoder_next(&decoder);
 }
 
-int main(void) {
+void decode_ahead(void) {
+    if (prefetch_ahead(&decoder) != 0) decoder_ahead(&decoder);
+}
+
+const struct frame_slot *get_frame(size_t index) {
+    return prefetch_get(&decoder, index);
+}
+
+void usage(FILE *out) {
+    fprintf(out,
+        "usage: ghost [--start-frame N] [--overlay[=ROW,COL]] [--wall[=COLSxROWS]]\n"
+        "             [--speeds LIST] [--shared-frames] [--pipeline] [--power-save]\n"
+        "             [--stats] [--trace FILE] [--record FILE]\n"
+        "       ghost --export cast FILE [--fps N] [--size COLSxROWS] [...]\n"
+        "       ghost --frame N | --once[=COUNT] [--start-frame N]\n"
+        "\n"
+        "  -s, --start-frame N   start playback at frame N (0-%d)\n"
+        "      --overlay[=ROW,COL]\n"
+        "                        draw over the main screen at ROW,COL, leaving the\n"
+        "                        rest of it alone; negative values count from the\n"
+        "                        bottom or right edge (default: 1,-1)\n"
+        "      --wall[=COLSxROWS]\n"
+        "                        tile the terminal with ghosts at staggered phases\n"
+        "                        (default: as many as fit)\n"
+        "      --speeds LIST     comma-separated playback speeds, cycled over the\n"
+        "                        wall's tiles (default: 1)\n"
+        "      --shared-frames   map decoded frames shared with other instances\n"
+        "                        instead of decoding them again\n"
+        "      --pipeline        compose on the main thread and write from another,\n"
+        "                        dropping stale frames when the terminal falls behind\n"
+        "      --power-save      coalesce wakeups and draw fewer frames under high\n"
+        "                        load or on battery\n"
+        "      --stats           print per-phase latency histograms on exit\n"
+        "      --trace FILE      write a Chrome/Perfetto trace of the frame loop\n"
+        "      --record FILE     save everything written to the terminal, with\n"
+        "                        timestamps, as an asciicast v2 file\n"
+        "      --export cast FILE\n"
+        "                        render one loop to an asciicast v2 file (- for\n"
+        "                        stdout) as fast as possible, then exit\n"
+        "      --fps N           frame rate of the export (default: %.2f)\n"
+        "      --size COLSxROWS  terminal size of the export (default: %dx%d)\n"
+        "      --frame N         print frame N to stdout and exit\n"
+        "      --once[=COUNT]    print COUNT frames from the start frame, redrawn in\n"
+        "                        place, to stdout and exit, leaving the terminal\n"
+        "                        mode alone (default: 1)\n"
+        "\n"
+        "SIGUSR1 prints the same statistics to stderr while running.\n"
+        "\n"
+        "keys: q quit, space pause, , . step one frame, < > seek %d frames,\n"
+        "      + - double or halve the speed, r reverse, p ping-pong\n",
+        FRAME_COUNT - 1, export_fps, export_cols, export_rows, SEEK_FRAMES
+    );
+}
+
+int parse_args(int argc, char **argv) {
+    static const struct option options[] = {
+        {"start-frame", required_argument, NULL, 's'},
+        {"overlay", optional_argument, NULL, 'o'},
+        {"wall", optional_argument, NULL, 'w'},
+        {"speeds", required_argument, NULL, 'v'},
+        {"shared-frames", no_argument, &shared_frames, 1},
+        {"pipeline", no_argument, &pipeline, 1},
+        {"power-save", no_argument, &power_save, 1},
+        {"stats", no_argument, &show_stats, 1},
+        {"trace", required_argument, NULL, 't'},
+        {"record", required_argument, NULL, 'R'},
+        {"export", required_argument, NULL, 'e'},
+        {"fps", required_argument, NULL, 'f'},
+        {"size", required_argument, NULL, 'z'},
+        {"frame", required_argument, NULL, 'F'},
+        {"once", optional_argument, NULL, 'O'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt, export_options = 0;
+
+    while ((opt = getopt_long(argc, argv, "s:t:h", options, NULL)) != -1) {
+        switch (opt) {
+        case 'F':
+            if (!once_count) once_count = 1;
+            /* fall through */
+        case 's': {
+            char *end;
+            long frame = strtol(optarg, &end, 10);
+            if (*optarg == '\0' || *end != '\0' || frame < 0 || frame >= FRAME_COUNT) {
+                fprintf(stderr, "Invalid %s: %s\n", opt == 'F' ? "frame" : "start frame", optarg);
+                return -1;
+            }
+            frame_offset = frame;
+            break;
+        }
+        case 'o': {
+            int row, col;
+            char extra;
+            overlay = 1;
+            if (!optarg) break;
+            if (sscanf(optarg, "%d,%d%c", &row, &col, &extra) != 2 || row == 0 || col == 0) {
+                fprintf(stderr, "Invalid overlay position: %s\n", optarg);
+                return -1;
+            }
+            overlay_row = row;
+            overlay_col = col;
+            break;
+        }
+        case 'w':
+            wall = 1;
+            if (optarg && wall_parse_grid(optarg) != 0) {
+                fprintf(stderr, "Invalid wall size: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'v':
+            if (wall_parse_speeds(optarg) != 0) {
+                fprintf(stderr, "Invalid speeds: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 't':
+            if (trace_open(optarg) != 0) {
+                fprintf(stderr, "Cannot open trace file %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'R':
+            if (record_open(optarg) != 0) {
+                fprintf(stderr, "Cannot open recording file %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'e':
+            if (strcmp(optarg, "cast") != 0) {
+                fprintf(stderr, "Unsupported export format: %s\n", optarg);
+                return -1;
+            }
+            if (optind >= argc) {
+                fprintf(stderr, "--export cast needs an output file\n");
+                return -1;
+            }
+            export_path = argv[optind++];
+            break;
+        case 'f': {
+            char *end;
+            export_fps = strtod(optarg, &end);
+            if (*optarg == '\0' || *end != '\0' || !(export_fps > 0) || export_fps > 1000) {
+                fprintf(stderr, "Invalid frame rate: %s\n", optarg);
+                return -1;
+            }
+            export_options = 1;
+            break;
+        }
+        case 'O':
+            once_count = 1;
+            if (optarg && once_parse_count(optarg) != 0) {
+                fprintf(stderr, "Invalid frame count: %s\n", optarg);
+                return -1;
+            }
+            break;
+        case 'z':
+            if (export_parse_size(optarg) != 0) {
+                fprintf(stderr, "Invalid export size: %s\n", optarg);
+                return -1;
+            }
+            export_options = 1;
+            break;
+        case 0:
+            break;
+        case 'h':
+            usage(stdout);
+            exit(EXIT_SUCCESS);
+        default:
+            usage(stderr);
+            return -1;
+        }
+    }
+
+    if (optind < argc) {
+        usage(stderr);
+        return -1;
+    }
+    if (wall && overlay) {
+        fprintf(stderr, "--wall and --overlay cannot be combined\n");
+        return -1;
+    }
+    if (export_options && !export_path) {
+        fprintf(stderr, "--fps and --size only apply to --export\n");
+        return -1;
+    }
+    if (export_path && record_enabled()) {
+        fprintf(stderr, "--record and --export cannot be combined\n");
+        return -1;
+    }
+    if (once_count && (wall || overlay || export_path || record_enabled())) {
+        fprintf(stderr, "--frame and --once cannot be combined with --wall, "
+            "--overlay, --export or --record\n");
+        return -1;
+    }
+    return 0;
+}
+
+#ifndef GHOST_NO_MAIN
+int main(int argc, char **argv) {
+    if (parse_args(argc, argv) != 0)
+        return EXIT_FAILURE;
+
+    if (once_count)
+        return once_run() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    if (load_frames() != 0) {
+        fprintf(stderr, "Embedded frame data is corrupt\n");
+        return EXIT_FAILURE;
+    }
+
+    if (shared_frames && store_open() != 0)
+        fprintf(stderr, "Shared frame store unavailable, decoding locally\n");
+
+    if (export_path)
+        return export_run() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    const char *term = getenv("TERM");
+    rep_supported = term && strcmp(term, "dumb") != 0 &&
+        strncmp(term, "linux", 5) != 0 && strncmp(term, "vt", 2) != 0;
+
     struct sigaction sa;
     memset(&sa, 0, sizeof(struct sigaction));
     sa.sa_handler = handle_resize;
     
     sigaction(SIGWINCH, &sa, NULL);
     signal(SIGINT, handle_sigint);
+    signal(SIGTERM, handle_sigint);
+    signal(SIGUSR1, handle_sigusr1);
+    signal(SIGTSTP, handle_sigtstp);
+    signal(SIGCONT, handle_sigcont);
+
+    interactive = isatty(STDIN_FILENO) && tcgetpgrp(STDIN_FILENO) == getpgrp();
+
+    if (wall) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        pool_start(cpus < POOL_THREADS_MAX ? (int)cpus : POOL_THREADS_MAX);
+    }
 
     get_terminal_size(&term_rows, &term_cols);
-    if (term_cols < 115 || term_rows < 56) {
+    if (wall) wall_grid();
+    if (!terminal_fits()) {
+        int need_cols = overlay ? IMAGE_WIDTH : 115;
+        int need_rows = overlay ? IMAGE_HEIGHT : 56;
+        if (wall && canvas_width() > need_cols) need_cols = canvas_width();
+        if (wall && canvas_rows > need_rows) need_rows = canvas_rows;
+
         fprintf(stderr,
             "Terminal size too small. Minimum "
             "required: %dx%d, Current: %dx%d\n",
-            115, 56, term_cols, term_rows
+            need_cols, need_rows, term_cols, term_rows
         );
         return EXIT_FAILURE;
     }
 
+    if (record_start(term_rows, term_cols) != 0) {
+        fprintf(stderr, "Cannot start recording\n");
+        return EXIT_FAILURE;
+    }
+
+    /* The set-up sequences stay queued and go out with the first frame. */
     prepare_terminal();
-    setvbuf(stdout, NULL, _IOFBF, 0);
 
-    buffer = malloc(IMAGE_HEIGHT * (term_cols + 1));
     update_dimensions();
-    preformat_frames();
+    if (alloc_buffers() != 0 || pipeline_start() != 0) {
+        restore_terminal();
+        return EXIT_FAILURE;
+    }
 
+    int status = EXIT_SUCCESS;
+    long long last_tick = 0, due_slot = -1;
     long long start_time = get_microseconds();
-    long long next_frame_time = start_time + MICROS_PER_FRAME;
 
-    while (1) {
+    timeline_start(start_time);
+    if (power_save) {
+        power_start();
+        start_time -= start_time % (MICROS_PER_FRAME * POWER_DIVISOR_MAX);
+    }
+
+    while (!quit_requested) {
+        if (suspend_requested)
+            suspend_self();
+
+        if (resumed) {
+            resume_terminal();
+            due_slot = -1;
+        }
+
+        if (resized)
+            apply_resize();
+
+        /* A recording that lost writes catches up with a full repaint. */
+        if (record_lost())
+            invalidate_screen();
+
+        if (stats_requested) {
+            stats_requested = 0;
+            pipeline_drain();
+            stats_print(stderr);
+        }
+
+        if (!focused) {
+            wait_for_input();
+            due_slot = -1;
+            continue;
+        }
+
         long long current_time = get_microseconds();
-        size_t frame_index = (current_time - start_time) / MICROS_PER_FRAME % FRAME_COUNT;
+        long long slot = (current_time - start_time) / MICROS_PER_FRAME;
+        long long deadline = start_time + slot * MICROS_PER_FRAME;
+        long long tick = timeline_tick(deadline);
+        long long missed = due_slot >= 0 && slot > due_slot ? slot - due_slot : 0;
+        size_t frame_index = timeline_frame(tick + frame_offset);
+
+        if (frame_index != last_frame_index || tick != last_tick) {
+            long long t0 = get_nanoseconds();
+            const struct frame_slot *frame = wall ? NULL : get_frame(frame_index);
+            if (wall ? wall_decode(tick) != 0 : !frame) {
+                status = EXIT_FAILURE;
+                break;
+            }
 
-        if (frame_index != last_frame_index) {
-            for (int i = 0; i < IMAGE_HEIGHT; i++) {
-                char *line = buffer + i * (term_cols + 1);
-                memset(line, ' ', term_cols);
-                line[term_cols] = '\0';
+            long long t1 = get_nanoseconds();
+            if (wall) wall_compose();
+            else compose_frame(frame);
 
-                memcpy(line + start_col, 
-                    formatted_frames[frame_index][i], 
-                    strlen(formatted_frames[frame_index][i])
-                );
+            /* A frame the pipeline has no room for is composed again later. */
+            long long t2 = get_nanoseconds();
+            size_t len = 0;
+            int queued = 0;
+            if (pipeline) queued = pipeline_submit((long)frame_index, deadline * 1000) == 0;
+            else len = wall ? wall_encode(output) : encode_frame(output);
 
-                move_cursor(start_row + i, 1);
-                write(STDOUT_FILENO, line, term_cols);
-                clear_line_to_end();
+            long long t3 = get_nanoseconds();
+            ssize_t written = pipeline ? 0 : fdio_write(output, len);
+
+            long long t4 = get_nanoseconds();
+            if (timeline_forward(tick + frame_offset)) {
+                if (wall) wall_ahead();
+                else decode_ahead();
+            }
+
+            long long t5 = get_nanoseconds();
+            size_t bytes = written > 0 ? (size_t)written : 0;
+            stats_phase(PHASE_DECODE, (t1 - t0) + (t5 - t4));
+            stats_phase(PHASE_COMPOSE, t2 - t1);
+            if (!pipeline) {
+                stats_phase(PHASE_ENCODE, t3 - t2);
+                stats_phase(PHASE_WRITE, t4 - t3);
+                stats_bytes(bytes);
+            } else if (!queued) {
+                missed++;
+            }
+
+            if (missed)
+                stats_dropped(missed);
+
+            if (trace_enabled()) {
+                trace_span("frame", t0, t5, frame_index);
+                trace_span("decode", t0, t1, frame_index);
+                trace_span("compose", t1, t2, frame_index);
+                if (pipeline) {
+                    trace_span("submit", t2, t3, frame_index);
+                } else {
+                    trace_span("encode", t2, t3, frame_index);
+                    trace_present(t3, t4, frame_index, bytes, deadline * 1000);
+                }
+                trace_span("decode-ahead", t4, t5, frame_index);
+                if (missed)
+                    trace_drop(t0, frame_index, missed);
             }
 
-            last_frame_index = frame_index;
+            last_frame_index = pipeline && !queued ? -1 : (sig_atomic_t)frame_index;
+            last_tick = tick;
         }
 
-        if (kbhit()) {
-            char c = getchar();
-            if (c == 'q' || c == 'Q')
-                break;
+        long long t = get_nanoseconds();
+        if (interactive && read_input())
+            break;
+        long long input_end = get_nanoseconds();
+        stats_phase(PHASE_INPUT, input_end - t);
+        trace_span("input", t, input_end, last_frame_index);
+
+        /*
+         * A key that moved the playhead is shown right away. Otherwise
+         * sleep until the first frame slot in which the playhead moves,
+         * only taking every divisor-th slot in power-saving mode.
+         */
+        if (timeline_tick(deadline) != last_tick)
+            continue;
+
+        long long wake = timeline_next(deadline);
+        if (last_frame_index < 0 && (wake < 0 || wake > deadline + MICROS_PER_FRAME))
+            wake = deadline + MICROS_PER_FRAME;
+        if (wake < 0) {
+            wait_for_input();
+            due_slot = -1;
+            continue;
         }
 
+        int divisor = power_divisor(current_time);
+        due_slot = (wake - start_time + MICROS_PER_FRAME - 1) / MICROS_PER_FRAME;
+        if (due_slot <= slot) due_slot = slot + 1;
+        due_slot = (due_slot + divisor - 1) / divisor * divisor;
+        long long next_frame_time = start_time + due_slot * MICROS_PER_FRAME;
+
         long long sleep_time = next_frame_time - get_microseconds();
         if (sleep_time > 0) {
-            struct timespec ts = {0, sleep_time * 1000};
+            struct timespec ts = {sleep_time / 1000000, sleep_time % 1000000 * 1000};
+            long long sleep_start = get_nanoseconds();
             nanosleep(&ts, NULL);
+            stats_wakeup();
+
+            long long woke = get_nanoseconds();
+            stats_phase(PHASE_OVERSHOOT, woke - next_frame_time * 1000);
+            trace_span("sleep", sleep_start, woke, last_frame_index);
+        } else {
+            stats_late();
         }
-        next_frame_time += MICROS_PER_FRAME;
     }
 
-    for (int i = 0; i < IMAGE_HEIGHT; i++) {
-        move_cursor(start_row + i, 1);
-        clear_line_to_end();
-    }
+    pipeline_stop();
+    prefetch_stop();
+    fdio_write(output, encode_clear(output));
 
+    pool_stop();
+    wall_free();
+    store_close();
     free(buffer);
+    free(screen);
+    free(line_length);
+    free(screen_length);
+    free(output);
     restore_terminal();
-    return EXIT_SUCCESS;
+
+    if (show_stats)
+        stats_print(stderr);
+    return status;
 }
+#endif
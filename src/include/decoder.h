@@ -0,0 +1,54 @@
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frames.h"
+#include "pack.h"
+
+/*
+ * Frame decoding from the embedded pack into rows of display cells. Each
+ * decoder keeps a small ring of decoded frames and reuses the rows that a
+ * delta frame leaves unchanged. The pack itself is opened once and only
+ * read afterwards, so decoders in different threads can share it.
+ */
+
+#define RING_FRAMES 4
+#define ROW_CELLS_MAX 96
+
+/*
+ * One terminal column, packed into 32 bits with no padding so that rows
+ * can be compared a word at a time. A wide glyph is followed by a cell with
+ * ch 0 and width 0 for the column it spills into.
+ */
+struct cell {
+    unsigned int ch : 21;       /* code point */
+    unsigned int fg : 8;        /* SGR foreground, 0 for the default */
+    unsigned int width : 3;     /* display columns: 1, 2, or 0 for the spill column */
+};
+
+#define CELL_CH_MAX 0x1fffff
+
+struct frame_slot {
+    int frame;
+    unsigned short offset[IMAGE_HEIGHT + 1];
+    struct cell cells[IMAGE_HEIGHT * ROW_CELLS_MAX];
+};
+
+struct decoder {
+    struct pack_cursor cursor;
+    struct frame_slot ring[RING_FRAMES];
+    int head, count;
+};
+
+extern struct pack pack;
+extern const struct frame_slot *frame_store;
+
+int frames_open(void);
+void decoder_reset(struct decoder *d);
+int decoder_next(struct decoder *d);
+void decoder_ahead(struct decoder *d);
+const struct frame_slot *decoder_get(struct decoder *d, size_t index);
+
+#endif
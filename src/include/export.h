@@ -0,0 +1,23 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <stddef.h>
+
+/*
+ * Offline export of one loop of the animation to an asciicast v2 file. The
+ * loop is split into chunks that are rendered by forked workers, each with
+ * its own copy of the canvas, and written out in order. Nothing sleeps.
+ */
+
+#define EXPORT_WORKERS_MAX 64
+#define EXPORT_EVENT_SIZE(len) ((len) * 6 + 64)
+
+extern const char *export_path;
+extern double export_fps;
+extern int export_rows, export_cols;
+
+int export_parse_size(const char *arg);
+char *export_event(char *ptr, long long us, char type, const char *data, size_t len);
+int export_run(void);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef FDIO_H
+#define FDIO_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ * Buffered terminal I/O on the raw file descriptors, without stdio.
+ * fdio_put() only queues bytes. fdio_flush() and fdio_write() are the
+ * flush points, and the latter sends the queue and a frame in one writev.
+ * Interrupted and would-block writes are retried; any other error drops
+ * what was queued. Everything that reaches the terminal is also handed to
+ * the recorder and counted in fdio_stats.
+ */
+
+#define FDIO_OUT_SIZE 4096
+#define FDIO_IN_SIZE 256
+
+struct fdio_stats {
+    unsigned long long bytes_out, writes, retries, errors;
+    unsigned long long bytes_in, reads;
+};
+
+extern struct fdio_stats fdio_stats;
+
+void fdio_put(const char *data, size_t len);
+ssize_t fdio_write(const char *data, size_t len);
+int fdio_flush(void);
+int fdio_pending(void);
+int fdio_getc(void);
+
+#endif
@@ -1,10 +1,27 @@
 #ifndef FRAMES_H
 #define FRAMES_H
 
+#include <stdint.h>
+
 #define IMAGE_WIDTH 77
 #define IMAGE_HEIGHT 41
 #define FRAME_COUNT 235
 
-extern const char *animation_frames[FRAME_COUNT][IMAGE_HEIGHT];
+#define COLOR_RESET "\x1b[0m"
+#define COLOR_BLUE "\x1b[34m"
+
+/*
+ * The source frames, generated by ghost-pack -t: every row NUL-terminated
+ * in one string, found through a table of offsets rather than pointers.
+ */
+extern const char animation_text[];
+extern const uint32_t animation_rows[FRAME_COUNT][IMAGE_HEIGHT];
+
+static inline const char *animation_row(int frame, int row) {
+    return animation_text + animation_rows[frame][row];
+}
+
+extern const unsigned char frames_pack[];
+extern const unsigned int frames_pack_size;
 
 #endif
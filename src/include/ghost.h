@@ -2,50 +2,121 @@
 #define ANIMATION_H
 
 #include <fcntl.h>
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/select.h>
 #include <termios.h>
 #include <time.h>
 #include <unistd.h>
 
-#define MAX_LINE_LENGTH 256
+#include "decoder.h"
+#include "export.h"
+#include "fdio.h"
+#include "frames.h"
+#include "libghost.h"
+#include "once.h"
+#include "pack.h"
+#include "pipeline.h"
+#include "pool.h"
+#include "power.h"
+#include "prefetch.h"
+#include "record.h"
+#include "simd.h"
+#include "stats.h"
+#include "store.h"
+#include "timeline.h"
+#include "trace.h"
+#include "utf8.h"
+#include "wall.h"
+
+#define SEEK_FRAMES 30
 #define MICROS_PER_FRAME 30000
 
-#define COLOR_RESET "\x1b[0m"
-#define COLOR_BLUE "\x1b[34m"
+#define TILE_WIDTH (IMAGE_WIDTH + 3)
+#define TILE_HEIGHT (IMAGE_HEIGHT + 1)
+
+#define CELL_BYTES_MAX 9
+#define ROW_OVERHEAD 32
+#define ROW_BYTES(cols) ((size_t)(cols) * CELL_BYTES_MAX + ROW_OVERHEAD)
+#define OUTPUT_SIZE(rows, cols) ((size_t)(rows) * ROW_BYTES(cols) + ROW_OVERHEAD)
+
 #define CURSOR_SHOW "\x1b[?25h"
 #define CURSOR_HIDE "\x1b[?25l"
 #define CLEAR_SCREEN "\x1b[2J"
 #define ERASE_LINE "\x1b[K"
+#define ERASE_DOWN "\x1b[J"
 #define MOVE_CURSOR_HOME "\x1b[H"
 #define ALTERNATE_SCREEN "\x1b[?1049h"
 #define MAIN_SCREEN "\x1b[?1049l"
+#define SAVE_CURSOR "\x1b" "7"
+#define RESTORE_CURSOR "\x1b" "8"
+#define FOCUS_EVENTS_ON "\x1b[?1004h"
+#define FOCUS_EVENTS_OFF "\x1b[?1004l"
 
-#define CSI(code) write(STDOUT_FILENO, code, sizeof("\x1b[" code) - 1)
+struct encoder {
+    int row, col, fg;
+};
+
+#define CSI(code) fdio_put(code, sizeof(code) - 1)
 
 long long get_microseconds(void);
 void get_terminal_size(int *rows, int *cols);
 void enable_raw_mode(void);
 void disable_raw_mode(void);
 int kbhit(void);
-void move_cursor(int row, int col);
+int read_input(void);
+void wait_for_input(void);
+char *encode_cursor(char *ptr, int row, int col);
 void clear_line_to_end(void);
 void update_dimensions(void);
+int terminal_fits(void);
+void set_grid(int rows, int cols);
+int canvas_width(void);
+void place_image(void);
+void center_image(void);
 void clear_screen(void);
 void prepare_terminal(void);
 void restore_terminal(void);
+int alloc_buffers(void);
+void reset_screen(void);
+void invalidate_screen(void);
 void handle_resize(int sig);
+void apply_resize(void);
 void handle_sigint(int sig);
-void preformat_frames(void);
-
-struct termios orig_termios;
+void handle_sigusr1(int sig);
+void handle_sigtstp(int sig);
+void handle_sigcont(int sig);
+void suspend_self(void);
+void resume_terminal(void);
+void compose_rows(const struct frame_slot *const *frames, int first, int last);
+void compose_frame(const struct frame_slot *frame);
+char *encode_rows(struct encoder *e, char *ptr, int first, int last);
+size_t encode_frame(char *out);
+size_t encode_canvas(char *out, const struct cell *cells, const size_t *lengths);
+size_t encode_clear(char *out);
+int load_frames(void);
+int decode_next(void);
+void decode_ahead(void);
+const struct frame_slot *get_frame(size_t index);
+void usage(FILE *out);
+int parse_args(int argc, char **argv);
 
-struct timespec frame_ts = {
-    .tv_sec = 0,
-    .tv_nsec = (MICROS_PER_FRAME / 2) * 1000
-};
+extern struct cell *buffer;
+extern struct cell *screen;
+extern char *output;
+extern size_t *line_length;
+extern size_t *screen_length;
+extern int rep_supported;
+extern int overlay;
+extern int focused;
+extern int overlay_row, overlay_col;
+extern int term_rows, term_cols;
+extern int start_row, start_col;
+extern int grid_rows, grid_cols, canvas_rows;
+extern long long frame_offset;
 
 #endif
@@ -0,0 +1,47 @@
+#ifndef LIBGHOST_H
+#define LIBGHOST_H
+
+#include <stddef.h>
+
+/*
+ * Embeddable renderer. A context renders any frame of the animation as
+ * lines of text with SGR colors, centered in a box of the given size and
+ * cropped to it, one '\n' after each line and trailing blanks left out.
+ * All memory is allocated by ghost_ctx_init(); rendering allocates nothing
+ * and does no I/O, and separate contexts may be used from separate threads
+ * at the same time. Only the ghost_ functions are visible in libghost.a.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef __GNUC__
+#define GHOST_API __attribute__((visibility("default")))
+#else
+#define GHOST_API
+#endif
+
+struct ghost_geometry {
+    int rows, cols;     /* size of the box, 0 for that of the image */
+};
+
+struct ghost_theme {
+    const char *color;  /* SGR parameters for the colored parts such as "35"
+                           or "38;5;213", "" for none, NULL for the original */
+};
+
+struct ghost_ctx;
+
+GHOST_API struct ghost_ctx *ghost_ctx_init(const struct ghost_geometry *geometry,
+                                           const struct ghost_theme *theme);
+GHOST_API void ghost_ctx_free(struct ghost_ctx *ctx);
+GHOST_API size_t ghost_frame_size(const struct ghost_ctx *ctx);
+GHOST_API long ghost_render_frame(struct ghost_ctx *ctx, int index, char *out, size_t cap);
+GHOST_API int ghost_frame_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef ONCE_H
+#define ONCE_H
+
+/*
+ * One-shot output for banners and prompts. Prints the start frame, or a
+ * burst of once_count frames redrawn in place a frame period apart, to
+ * stdout through libghost and returns. The terminal is left in whatever
+ * mode it was in and only the printed frames are decoded.
+ */
+
+extern int once_count;
+
+int once_parse_count(const char *arg);
+int once_run(void);
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Frame pack layout (all integers little-endian):
+ *
+ *   header      PACK_HEADER_SIZE bytes, see pack_open()
+ *   row table   row_count + 1 u32 offsets into the row data
+ *   row data    interned rows, terminal-ready (markup already expanded)
+ *   frames      one record per frame, in playback order
+ *   index       one u32 frame stream offset per keyframe
+ *
+ * A frame record is either PACK_FRAME_KEY followed by `height` u16 row ids,
+ * or PACK_FRAME_DELTA followed by a bitmask of the rows that changed since
+ * the previous frame and one u16 row id per set bit. Every
+ * keyframe_interval-th frame is a keyframe, so reaching any frame from the
+ * index takes at most keyframe_interval - 1 delta records.
+ *
+ * With PACK_COMPRESSED each row is a u16 reference row id (PACK_NO_REF for
+ * none) followed by an LZ stream whose window starts with the decoded
+ * reference row. References always point to a lower id and chains are at
+ * most PACK_REF_DEPTH long, so any row decodes in bounded time.
+ */
+
+#define PACK_MAGIC "GHPK"
+#define PACK_VERSION 2
+#define PACK_HEADER_SIZE 40
+
+#define PACK_COMPRESSED 0x0001
+
+#define PACK_FRAME_KEY 0
+#define PACK_FRAME_DELTA 1
+
+#define PACK_KEYFRAME_INTERVAL 16
+
+#define PACK_ROW_MAX 256
+#define PACK_ROW_BUF (PACK_ROW_MAX * 2)
+#define PACK_HEIGHT_MAX 256
+#define PACK_NO_REF 0xffff
+#define PACK_REF_DEPTH 4
+
+#define PACK_MIN_MATCH 3
+#define PACK_MAX_OFFSET 255
+
+struct pack {
+    const uint8_t *data;
+    size_t size;
+    uint16_t flags;
+    uint16_t width;
+    uint16_t height;
+    uint32_t frame_count;
+    uint32_t row_count;
+    const uint8_t *row_table;
+    const uint8_t *rows;
+    size_t rows_size;
+    const uint8_t *frames;
+    size_t frames_size;
+    uint16_t keyframe_interval;
+    const uint8_t *index;
+};
+
+struct pack_cursor {
+    const struct pack *pack;
+    uint32_t frame;
+    size_t offset;
+    uint16_t ids[PACK_HEIGHT_MAX];
+    uint8_t changed[PACK_HEIGHT_MAX / 8];
+};
+
+static inline uint16_t pack_get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static inline uint32_t pack_get32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+           (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline int pack_row_changed(const struct pack_cursor *c, int row) {
+    return c->changed[row >> 3] >> (row & 7) & 1;
+}
+
+int pack_open(struct pack *p, const void *data, size_t size);
+int pack_row(const struct pack *p, uint32_t id, char *out);
+int pack_lz_decode(const uint8_t *src, size_t len, char *out, size_t pos);
+void pack_rewind(struct pack_cursor *c, const struct pack *p);
+int pack_next(struct pack_cursor *c);
+int pack_seek(struct pack_cursor *c, uint32_t frame);
+
+#endif
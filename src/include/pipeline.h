@@ -0,0 +1,25 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+/*
+ * Optional two-thread pipeline. The main thread composes each frame and
+ * copies it into one of PIPELINE_SLOTS preallocated canvases, handing it to
+ * a writer thread over a lock-free single-producer single-consumer ring.
+ * The writer owns the screen model: it encodes the newest queued frame and
+ * discards older ones unwritten. A frame that finds every slot taken is
+ * dropped and composed again a frame period later. A terminal that blocks
+ * on a write therefore never holds up input or timekeeping. The writer
+ * keeps its own histograms, which pipeline_drain() merges into the totals.
+ */
+
+#define PIPELINE_SLOTS 3
+
+extern int pipeline;
+
+int pipeline_alloc(void);
+int pipeline_start(void);
+int pipeline_submit(long frame, long long deadline);
+void pipeline_drain(void);
+void pipeline_stop(void);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef POOL_H
+#define POOL_H
+
+/*
+ * Persistent worker pool for per-frame fan-out. pool_run() hands out job
+ * indexes 0..count-1 to the workers and the calling thread, and returns once
+ * every job has finished.
+ */
+
+#define POOL_THREADS_MAX 4
+
+typedef void (*pool_job)(int index, void *arg);
+
+int pool_start(int threads);
+void pool_run(pool_job job, void *arg, int count);
+void pool_stop(void);
+int pool_threads(void);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef POWER_H
+#define POWER_H
+
+/*
+ * Power-saving mode: a wide timer slack lets the kernel batch our timers
+ * with others, frame slots are aligned to a system-wide grid so several
+ * players wake together, and frames are only drawn every 2nd or 4th slot
+ * while the load average is high or the battery is discharging or low.
+ * /proc and /sys are read below $GHOST_SYSROOT when it is set, so the
+ * policy can be tried against fake files.
+ */
+
+#define POWER_TIMER_SLACK_NS 10000000
+#define POWER_CHECK_US 2000000
+#define POWER_DIVISOR_MAX 4
+#define POWER_LOAD_HIGH 1.0
+#define POWER_BATTERY_LOW 20
+
+extern int power_save;
+
+void power_start(void);
+int power_divisor(long long now);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stddef.h>
+
+/*
+ * Background decoding ahead of the playhead. The first time the player asks
+ * to decode ahead, which is once its first frame has been written, a thread
+ * takes over keeping the decoder's ring full, so the main thread only decodes
+ * after a seek. The ring is shared under a mutex; the thread only fills slots
+ * past the current frame, so the frame being composed is never overwritten.
+ * Nothing is started on a single CPU or over a shared frame store.
+ */
+
+struct decoder;
+struct frame_slot;
+
+int prefetch_ahead(struct decoder *d);
+const struct frame_slot *prefetch_get(struct decoder *d, size_t index);
+void prefetch_stop(void);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stddef.h>
+
+/*
+ * Live recording of everything written to the terminal, as an asciicast v2
+ * file. The render thread copies each write into a lock-free single-producer
+ * single-consumer ring and a writer thread formats and saves it, so a slow
+ * disk only ever costs dropped records, never a late frame. A gap is marked
+ * in the file, and record_lost() tells the player to repaint in full so the
+ * recording shows the right screen again.
+ */
+
+#define RECORD_RING_SIZE (4 << 20)
+
+int record_open(const char *path);
+int record_enabled(void);
+int record_start(int rows, int cols);
+void record_output(const char *data, size_t len);
+void record_resize(int rows, int cols);
+int record_lost(void);
+void record_close(void);
+
+#endif
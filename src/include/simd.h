@@ -0,0 +1,39 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "decoder.h"
+
+/*
+ * Hot loops of row decoding, composition and frame diffing, each built in a
+ * scalar, an SSE4.2 and an AVX2 variant. The best one the CPU and the OS
+ * support is picked from CPUID before main, so one portable binary is fast
+ * everywhere. Static musl builds have no ifunc, hence a table of pointers.
+ */
+
+enum simd_level {
+    SIMD_SCALAR,
+    SIMD_SSE42,
+    SIMD_AVX2,
+};
+
+struct simd_kernels {
+    /* Bytes before the first ESC or non-ASCII byte in [src, end). */
+    size_t (*ascii_run)(const char *src, const char *end);
+    /* One width 1 cell of color fg for each of the n bytes at src. */
+    void (*widen)(struct cell *out, const char *src, size_t n, uint8_t fg);
+    /* n copies of c. */
+    void (*fill)(struct cell *out, struct cell c, size_t n);
+    /* Leading cells of a and b equal in code point, color and width. */
+    size_t (*same_prefix)(const struct cell *a, const struct cell *b, size_t n);
+};
+
+extern struct simd_kernels simd;
+
+int simd_supported(void);
+int simd_select(int level);
+const char *simd_name(int level);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Log-bucketed histograms: each power of two is split into
+ * HIST_SUB_BUCKETS linear sub-buckets, so percentiles are reported within
+ * 1 / HIST_SUB_BUCKETS (about 3%) of the true value at any magnitude.
+ */
+#define HIST_SUB_BITS 5
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (64 * HIST_SUB_BUCKETS)
+
+enum phase {
+    PHASE_DECODE,
+    PHASE_COMPOSE,
+    PHASE_ENCODE,
+    PHASE_WRITE,
+    PHASE_INPUT,
+    PHASE_OVERSHOOT,
+    PHASE_COUNT
+};
+
+struct histogram {
+    unsigned long long count;
+    unsigned long long sum;
+    unsigned long long max;
+    unsigned int buckets[HIST_BUCKETS];
+};
+
+/*
+ * Histograms kept by a thread other than the main one, which merges them
+ * into the totals once that thread is idle.
+ */
+struct stats_shard {
+    struct histogram phases[PHASE_COUNT];
+    struct histogram bytes;
+};
+
+void hist_record(struct histogram *h, unsigned long long value);
+unsigned long long hist_percentile(const struct histogram *h, double p);
+
+long long get_nanoseconds(void);
+void stats_phase(enum phase phase, long long ns);
+void stats_bytes(size_t bytes);
+void stats_shard_phase(struct stats_shard *s, enum phase phase, long long ns);
+void stats_shard_bytes(struct stats_shard *s, size_t bytes);
+void stats_merge(struct stats_shard *s);
+void stats_late(void);
+void stats_dropped(long long frames);
+void stats_wakeup(void);
+void stats_print(FILE *out);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef STORE_H
+#define STORE_H
+
+/*
+ * Shared frame store. The first instance decodes every frame of the pack
+ * into a POSIX shared memory object named after the user and a hash of the
+ * pack, and later instances map it read-only instead of decoding, so the
+ * memory used by many players is that of one. An object from a publisher
+ * that died half-way is replaced; one still being written, even before its
+ * header is, is skipped.
+ */
+
+#define STORE_MAGIC 0x31534654534f4847ULL
+#define STORE_SLOTS_OFFSET 4096
+
+struct store_header {
+    unsigned long long magic;
+    unsigned long long hash;
+    unsigned int ready;
+    int publisher;
+    unsigned int frame_count;
+    unsigned int slot_size;
+};
+
+extern int shared_frames;
+
+int store_open(void);
+void store_close(void);
+
+#endif
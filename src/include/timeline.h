@@ -0,0 +1,38 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stddef.h>
+
+/*
+ * The playhead is a position in frames that moves at a signed speed (in
+ * frames per frame period) from the moment of the last change, so pausing,
+ * stepping, seeking and speed changes only re-anchor it. Times are in
+ * microseconds.
+ */
+
+#define TIMELINE_SPEED_MIN 0.125
+#define TIMELINE_SPEED_MAX 8.0
+
+struct timeline {
+    long long origin;
+    double position;
+    double speed;
+    int paused;
+    int pingpong;
+};
+
+extern struct timeline timeline;
+
+void timeline_start(long long now);
+long long timeline_tick(long long now);
+long long timeline_next(long long now);
+size_t timeline_frame(long long position);
+int timeline_forward(long long position);
+void timeline_pause(long long now);
+void timeline_step(long long now, long long frames);
+void timeline_seek(long long now, long long frames);
+void timeline_speed(long long now, double factor);
+void timeline_reverse(long long now);
+void timeline_pingpong(long long now);
+
+#endif
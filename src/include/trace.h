@@ -0,0 +1,32 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+
+/*
+ * Chrome trace of the main loop. Events from the pipeline writer land on a
+ * second track, so the ring is indexed atomically.
+ */
+#define TRACE_EVENTS 65536
+
+struct trace_event {
+    const char *name;
+    char type;
+    long long ts;
+    long long dur;
+    long frame;
+    long long bytes;
+    long long deadline;
+    long long count;
+    int tid;
+};
+
+int trace_open(const char *path);
+int trace_enabled(void);
+void trace_span(const char *name, long long start, long long end, long frame);
+void trace_present(long long start, long long end, long frame,
+                   size_t bytes, long long deadline);
+void trace_drop(long long ts, long frame, long long dropped);
+void trace_close(void);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Display width of a code point in terminal columns: 2 for East Asian wide
+ * and fullwidth characters and emoji, 0 for combining marks, joiners and
+ * variation selectors, 1 otherwise.
+ */
+int char_width(uint32_t cp);
+
+/* Decode one UTF-8 sequence from [s, end), returning its length in bytes. */
+size_t utf8_decode(const char *s, const char *end, uint32_t *cp);
+
+static inline size_t utf8_length(uint32_t cp) {
+    return cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+}
+
+static inline char *utf8_encode(char *ptr, uint32_t cp) {
+    if (cp < 0x80) {
+        *ptr++ = (char)cp;
+    } else if (cp < 0x800) {
+        *ptr++ = (char)(0xc0 | cp >> 6);
+        *ptr++ = (char)(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        *ptr++ = (char)(0xe0 | cp >> 12);
+        *ptr++ = (char)(0x80 | (cp >> 6 & 0x3f));
+        *ptr++ = (char)(0x80 | (cp & 0x3f));
+    } else {
+        *ptr++ = (char)(0xf0 | cp >> 18);
+        *ptr++ = (char)(0x80 | (cp >> 12 & 0x3f));
+        *ptr++ = (char)(0x80 | (cp >> 6 & 0x3f));
+        *ptr++ = (char)(0x80 | (cp & 0x3f));
+    }
+    return ptr;
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef VT_H
+#define VT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define VT_MAX_PARAMS 16
+
+/*
+ * Minimal terminal model covering what ghost emits: printable UTF-8,
+ * CR/LF/BS, CUP/HVP, CUU/CUD/CUF/CUB/CHA/VPA, EL, ED, ECH, REP, SGR colors,
+ * DECSC/DECRC and the alternate screen. Anything else is counted in
+ * `unknown`. Wide glyphs take two cells, the second with ch 0.
+ */
+
+struct vt_cell {
+    uint32_t ch;
+    uint8_t fg;
+};
+
+struct vt {
+    int rows, cols;
+    int row, col;
+    int wrap_pending;
+    uint8_t fg;
+    int saved_row, saved_col;
+    uint8_t saved_fg;
+    uint32_t last_ch;
+    struct vt_cell *cells;
+
+    int state;
+    int params[VT_MAX_PARAMS];
+    int param_count;
+    int private_mode;
+    uint32_t codepoint;
+    int utf8_left;
+    unsigned long long unknown;
+};
+
+int vt_init(struct vt *vt, int rows, int cols);
+void vt_free(struct vt *vt);
+void vt_feed(struct vt *vt, const char *data, size_t len);
+
+static inline const struct vt_cell *vt_cell(const struct vt *vt, int row, int col) {
+    return &vt->cells[(size_t)row * vt->cols + col];
+}
+
+#endif
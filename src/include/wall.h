@@ -0,0 +1,27 @@
+#ifndef WALL_H
+#define WALL_H
+
+#include <stddef.h>
+
+/*
+ * Wall mode tiles the terminal with ghosts. Every tile has its own decoder
+ * over the shared frame pack, a phase offset and a speed; decoding,
+ * composition and encoding are split across the worker pool.
+ */
+
+#define WALL_SPEEDS_MAX 32
+
+extern int wall;
+extern int wall_rows, wall_cols;
+
+int wall_parse_grid(const char *arg);
+int wall_parse_speeds(const char *arg);
+void wall_grid(void);
+int wall_alloc(void);
+int wall_decode(long long tick);
+void wall_compose(void);
+size_t wall_encode(char *out);
+void wall_ahead(void);
+void wall_free(void);
+
+#endif
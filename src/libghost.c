@@ -0,0 +1,151 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/decoder.h"
+#include "include/libghost.h"
+#include "include/utf8.h"
+
+#define GHOST_BOX_MAX 4096
+#define GHOST_COLOR_MAX 32
+
+struct ghost_ctx {
+    struct decoder decoder;
+    int rows, cols;
+    int top, left;
+    int plain;
+    char color[GHOST_COLOR_MAX];
+    size_t size;
+};
+
+static const struct cell blank = {' ', 0, 1};
+
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static int open_status = -1;
+
+static void open_frames(void) {
+    open_status = frames_open();
+}
+
+/* Only SGR parameters are accepted, so a theme cannot smuggle in escapes. */
+static int valid_color(const char *color) {
+    if (strlen(color) >= GHOST_COLOR_MAX) return 0;
+    for (const char *p = color; *p; p++)
+        if ((*p < '0' || *p > '9') && *p != ';') return 0;
+    return 1;
+}
+
+struct ghost_ctx *ghost_ctx_init(const struct ghost_geometry *geometry,
+                                 const struct ghost_theme *theme) {
+    pthread_once(&once, open_frames);
+    if (open_status != 0) return NULL;
+
+    int rows = geometry && geometry->rows ? geometry->rows : IMAGE_HEIGHT;
+    int cols = geometry && geometry->cols ? geometry->cols : pack.width;
+    const char *color = theme ? theme->color : NULL;
+
+    if (rows < 0 || cols < 0 || rows > GHOST_BOX_MAX || cols > GHOST_BOX_MAX ||
+        (color && !valid_color(color)))
+        return NULL;
+
+    struct ghost_ctx *ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) return NULL;
+
+    decoder_reset(&ctx->decoder);
+    ctx->rows = rows;
+    ctx->cols = cols;
+    ctx->top = (rows - IMAGE_HEIGHT) / 2;
+    ctx->left = (cols - pack.width) / 2;
+    ctx->plain = color && *color == '\0';
+    if (color) strcpy(ctx->color, color);
+
+    /* Every cell may need a color change, then up to four UTF-8 bytes. */
+    size_t sgr = 3 + (color ? strlen(color) : 3);
+    ctx->size = (size_t)rows * ((size_t)cols * (sgr + 4) + 4) + 1;
+    return ctx;
+}
+
+void ghost_ctx_free(struct ghost_ctx *ctx) {
+    free(ctx);
+}
+
+size_t ghost_frame_size(const struct ghost_ctx *ctx) {
+    return ctx->size;
+}
+
+int ghost_frame_count(void) {
+    return FRAME_COUNT;
+}
+
+static char *put_sgr(const struct ghost_ctx *ctx, char *ptr, int fg) {
+    *ptr++ = '\x1b';
+    *ptr++ = '[';
+
+    if (fg && ctx->color[0]) {
+        size_t len = strlen(ctx->color);
+        memcpy(ptr, ctx->color, len);
+        ptr += len;
+    } else if (fg) {
+        if (fg >= 100) *ptr++ = '0' + fg / 100;
+        if (fg >= 10) *ptr++ = '0' + fg / 10 % 10;
+        *ptr++ = '0' + fg % 10;
+    }
+
+    *ptr++ = 'm';
+    return ptr;
+}
+
+static char *render_row(const struct ghost_ctx *ctx, const struct cell *cells, int n,
+                        char *ptr) {
+    char *mark = ptr;
+    int fg = 0, mark_fg = 0;
+
+    for (int col = 0; col < ctx->cols; col++) {
+        int k = col - ctx->left;
+        struct cell c = k >= 0 && k < n ? cells[k] : blank;
+
+        /* Half of a wide glyph at either edge of the box is left blank. */
+        if (c.width == 0 || (c.width == 2 && col + 1 >= ctx->cols))
+            c = blank;
+
+        if (c.ch != ' ' && c.fg != fg && !ctx->plain) {
+            ptr = put_sgr(ctx, ptr, c.fg);
+            fg = c.fg;
+        }
+
+        ptr = utf8_encode(ptr, c.ch);
+        if (c.ch != ' ') {
+            mark = ptr;
+            mark_fg = fg;
+        }
+        col += c.width - 1;
+    }
+
+    ptr = mark;
+    if (mark_fg) ptr = put_sgr(ctx, ptr, 0);
+    *ptr++ = '\n';
+    return ptr;
+}
+
+long ghost_render_frame(struct ghost_ctx *ctx, int index, char *out, size_t cap) {
+    if (index < 0 || index >= FRAME_COUNT || cap < ctx->size) return -1;
+
+    const struct frame_slot *frame = decoder_get(&ctx->decoder, (size_t)index);
+    if (!frame) return -1;
+
+    char *ptr = out;
+    for (int r = 0; r < ctx->rows; r++) {
+        int i = r - ctx->top;
+
+        if (i < 0 || i >= IMAGE_HEIGHT) {
+            *ptr++ = '\n';
+            continue;
+        }
+
+        const struct cell *cells = frame->cells + frame->offset[i];
+        ptr = render_row(ctx, cells, frame->offset[i + 1] - frame->offset[i], ptr);
+    }
+
+    *ptr = '\0';
+    return ptr - out;
+}
@@ -0,0 +1,64 @@
+#include "include/ghost.h"
+
+int once_count;
+
+int once_parse_count(const char *arg) {
+    char *end;
+    long count = strtol(arg, &end, 10);
+
+    if (*arg == '\0' || *end != '\0' || count < 1 || count > FRAME_COUNT)
+        return -1;
+    once_count = (int)count;
+    return 0;
+}
+
+int once_run(void) {
+    struct ghost_geometry box = {0, 0};
+    struct winsize w;
+
+    /*
+     * On a terminal the ghost is centered in its width, and a burst is kept
+     * within its height so the cursor can move back up over the whole frame.
+     */
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0 && w.ws_col > 0) {
+        box.cols = w.ws_col;
+        if (once_count > 1 && w.ws_row > 1 && w.ws_row - 1 < IMAGE_HEIGHT)
+            box.rows = w.ws_row - 1;
+    }
+
+    struct ghost_ctx *ctx = ghost_ctx_init(&box, NULL);
+    if (!ctx) return -1;
+
+    if (shared_frames && store_open() != 0)
+        fprintf(stderr, "Shared frame store unavailable, decoding locally\n");
+
+    size_t cap = ghost_frame_size(ctx);
+    char *text = malloc(cap + 32);
+    int lines = box.rows ? box.rows : IMAGE_HEIGHT;
+    int status = text ? 0 : -1;
+    long long start = get_microseconds();
+
+    for (int i = 0; i < once_count && status == 0; i++) {
+        char *ptr = text;
+        if (i > 0) ptr += sprintf(ptr, "\x1b[%dA\r" ERASE_DOWN, lines);
+
+        long len = ghost_render_frame(ctx, (int)((frame_offset + i) % FRAME_COUNT), ptr, cap);
+        if (len < 0) {
+            status = -1;
+            break;
+        }
+
+        long long wait = start + (long long)i * MICROS_PER_FRAME - get_microseconds();
+        if (wait > 0) {
+            struct timespec ts = {wait / 1000000, wait % 1000000 * 1000};
+            nanosleep(&ts, NULL);
+        }
+
+        size_t total = (size_t)(ptr - text) + (size_t)len;
+        if (fdio_write(text, total) != (ssize_t)total) status = -1;
+    }
+
+    free(text);
+    ghost_ctx_free(ctx);
+    return status;
+}
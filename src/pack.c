@@ -0,0 +1,213 @@
+#include <string.h>
+
+#include "include/pack.h"
+
+int pack_open(struct pack *p, const void *data, size_t size) {
+    const uint8_t *d = data;
+
+    if (size < PACK_HEADER_SIZE || memcmp(d, PACK_MAGIC, 4) != 0)
+        return -1;
+    if (pack_get16(d + 4) != PACK_VERSION)
+        return -1;
+
+    p->data = d;
+    p->size = size;
+    p->flags = pack_get16(d + 6);
+    p->width = pack_get16(d + 8);
+    p->height = pack_get16(d + 10);
+    p->frame_count = pack_get32(d + 12);
+    p->row_count = pack_get32(d + 16);
+
+    uint32_t rows_offset = pack_get32(d + 20);
+    uint32_t frames_offset = pack_get32(d + 24);
+    uint32_t frames_size = pack_get32(d + 28);
+    uint32_t index_offset = pack_get32(d + 36);
+
+    p->keyframe_interval = pack_get16(d + 32);
+
+    if (p->height == 0 || p->height > PACK_HEIGHT_MAX || p->frame_count == 0)
+        return -1;
+    if (p->row_count == 0 || p->row_count >= PACK_NO_REF)
+        return -1;
+    if (rows_offset < PACK_HEADER_SIZE || rows_offset > size ||
+        (size - rows_offset) / 4 < (size_t)p->row_count + 1)
+        return -1;
+    if (frames_offset > size || frames_size > size - frames_offset)
+        return -1;
+    if (p->keyframe_interval == 0 || index_offset > size ||
+        (size - index_offset) / 4 <
+        (p->frame_count - 1) / p->keyframe_interval + 1)
+        return -1;
+
+    p->row_table = d + rows_offset;
+    p->rows = p->row_table + 4 * ((size_t)p->row_count + 1);
+    p->rows_size = pack_get32(p->row_table + 4 * (size_t)p->row_count);
+    p->frames = d + frames_offset;
+    p->frames_size = frames_size;
+    p->index = d + index_offset;
+
+    if (p->rows_size > size - (size_t)(p->rows - d))
+        return -1;
+    if (p->frames_size == 0 || p->frames[0] != PACK_FRAME_KEY)
+        return -1;
+
+    return 0;
+}
+
+int pack_lz_decode(const uint8_t *src, size_t len, char *out, size_t pos) {
+    const uint8_t *end = src + len;
+    size_t start = pos;
+
+    while (src < end) {
+        uint8_t token = *src++;
+        size_t lit = token >> 4;
+        size_t match = token & 15;
+
+        if (lit == 15) {
+            uint8_t b;
+            do {
+                if (src >= end) return -1;
+                b = *src++;
+                lit += b;
+            } while (b == 255);
+        }
+        if (lit > (size_t)(end - src) || pos - start + lit > PACK_ROW_MAX)
+            return -1;
+        memcpy(out + pos, src, lit);
+        src += lit;
+        pos += lit;
+
+        if (src == end) break;
+
+        size_t offset = *src++;
+        if (match == 15) {
+            uint8_t b;
+            do {
+                if (src >= end) return -1;
+                b = *src++;
+                match += b;
+            } while (b == 255);
+        }
+        match += PACK_MIN_MATCH;
+
+        if (offset == 0 || offset > pos || pos - start + match > PACK_ROW_MAX)
+            return -1;
+
+        char *from = out + pos - offset;
+        for (size_t i = 0; i < match; i++)
+            out[pos + i] = from[i];
+        pos += match;
+    }
+
+    return (int)(pos - start);
+}
+
+int pack_row(const struct pack *p, uint32_t id, char *out) {
+    if (id >= p->row_count) return -1;
+
+    uint32_t begin = pack_get32(p->row_table + 4 * (size_t)id);
+    uint32_t end = pack_get32(p->row_table + 4 * ((size_t)id + 1));
+    if (begin > end || end > p->rows_size) return -1;
+
+    if (!(p->flags & PACK_COMPRESSED)) {
+        if (end - begin > PACK_ROW_MAX) return -1;
+        memcpy(out, p->rows + begin, end - begin);
+        return (int)(end - begin);
+    }
+
+    uint32_t chain[PACK_REF_DEPTH + 1];
+    int depth = 0;
+
+    chain[depth++] = id;
+    for (;;) {
+        uint32_t cur = chain[depth - 1];
+        uint32_t off = pack_get32(p->row_table + 4 * (size_t)cur);
+        uint32_t next = pack_get32(p->row_table + 4 * ((size_t)cur + 1));
+        if (next < off + 2 || next > p->rows_size) return -1;
+
+        uint16_t ref = pack_get16(p->rows + off);
+        if (ref == PACK_NO_REF) break;
+        if (ref >= cur || depth > PACK_REF_DEPTH) return -1;
+        chain[depth++] = ref;
+    }
+
+    int len = 0;
+    while (depth--) {
+        uint32_t cur = chain[depth];
+        uint32_t off = pack_get32(p->row_table + 4 * (size_t)cur) + 2;
+        uint32_t next = pack_get32(p->row_table + 4 * ((size_t)cur + 1));
+
+        int n = pack_lz_decode(p->rows + off, next - off, out, (size_t)len);
+        if (n < 0) return -1;
+        memmove(out, out + len, (size_t)n);
+        len = n;
+    }
+
+    return len;
+}
+
+void pack_rewind(struct pack_cursor *c, const struct pack *p) {
+    c->pack = p;
+    c->frame = 0;
+    c->offset = 0;
+}
+
+int pack_next(struct pack_cursor *c) {
+    const struct pack *p = c->pack;
+
+    if (c->frame == p->frame_count) {
+        c->frame = 0;
+        c->offset = 0;
+    }
+
+    const uint8_t *src = p->frames + c->offset;
+    const uint8_t *end = p->frames + p->frames_size;
+    int height = p->height;
+    size_t mask_size = ((size_t)height + 7) / 8;
+
+    if (src >= end) return -1;
+
+    if (*src == PACK_FRAME_KEY) {
+        src++;
+        if ((size_t)(end - src) < 2 * (size_t)height) return -1;
+        for (int r = 0; r < height; r++, src += 2)
+            c->ids[r] = pack_get16(src);
+        memset(c->changed, 0xff, sizeof(c->changed));
+    } else if (*src == PACK_FRAME_DELTA) {
+        src++;
+        if ((size_t)(end - src) < mask_size) return -1;
+        memcpy(c->changed, src, mask_size);
+        src += mask_size;
+        for (int r = 0; r < height; r++) {
+            if (!pack_row_changed(c, r)) continue;
+            if (end - src < 2) return -1;
+            c->ids[r] = pack_get16(src);
+            src += 2;
+        }
+    } else {
+        return -1;
+    }
+
+    for (int r = 0; r < height; r++)
+        if (c->ids[r] >= p->row_count) return -1;
+
+    c->offset = (size_t)(src - p->frames);
+    return (int)c->frame++;
+}
+
+int pack_seek(struct pack_cursor *c, uint32_t frame) {
+    const struct pack *p = c->pack;
+    if (frame >= p->frame_count) return -1;
+
+    uint32_t key = frame / p->keyframe_interval;
+    size_t offset = pack_get32(p->index + 4 * (size_t)key);
+    if (offset >= p->frames_size || p->frames[offset] != PACK_FRAME_KEY)
+        return -1;
+
+    c->frame = key * p->keyframe_interval;
+    c->offset = offset;
+    while (c->frame < frame)
+        if (pack_next(c) < 0) return -1;
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "include/ghost.h"
+
+struct pipeline_slot {
+    struct cell *cells;
+    size_t *lengths;
+    long frame;
+    long long deadline;
+};
+
+int pipeline;
+
+static struct pipeline_slot slots[PIPELINE_SLOTS];
+static size_t head, tail;
+static int running, stopping;
+static sem_t ready;
+static pthread_t thread;
+static struct stats_shard writer_stats;
+
+int pipeline_alloc(void) {
+    size_t cells = (size_t)canvas_rows * term_cols;
+
+    for (int i = 0; i < PIPELINE_SLOTS; i++) {
+        struct cell *c = realloc(slots[i].cells, cells * sizeof(struct cell));
+        if (c) slots[i].cells = c;
+
+        size_t *l = realloc(slots[i].lengths, canvas_rows * sizeof(size_t));
+        if (l) slots[i].lengths = l;
+
+        if (!c || !l) return -1;
+    }
+    return 0;
+}
+
+/*
+ * Frames [tail, head) are queued and stay untouched by the main thread
+ * until tail passes them, which only happens once the newest of them has
+ * been written.
+ */
+static void *writer(void *unused) {
+    for (;;) {
+        while (sem_wait(&ready) != 0 && errno == EINTR)
+            ;
+        stats_wakeup();
+
+        size_t end = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+        if (end != tail) {
+            const struct pipeline_slot *s = &slots[(end - 1) % PIPELINE_SLOTS];
+            if (end - tail > 1) stats_dropped((long long)(end - tail - 1));
+
+            long long t0 = get_nanoseconds();
+            size_t len = encode_canvas(output, s->cells, s->lengths);
+
+            long long t1 = get_nanoseconds();
+            ssize_t written = fdio_write(output, len);
+
+            long long t2 = get_nanoseconds();
+            size_t bytes = written > 0 ? (size_t)written : 0;
+            stats_shard_phase(&writer_stats, PHASE_ENCODE, t1 - t0);
+            stats_shard_phase(&writer_stats, PHASE_WRITE, t2 - t1);
+            stats_shard_bytes(&writer_stats, bytes);
+            trace_span("encode", t0, t1, s->frame);
+            trace_present(t1, t2, s->frame, bytes, s->deadline);
+
+            __atomic_store_n(&tail, end, __ATOMIC_RELEASE);
+        }
+
+        if (__atomic_load_n(&stopping, __ATOMIC_ACQUIRE) &&
+            tail == __atomic_load_n(&head, __ATOMIC_ACQUIRE))
+            break;
+    }
+    return unused;
+}
+
+int pipeline_start(void) {
+    if (!pipeline || running) return 0;
+    if (sem_init(&ready, 0, 0) != 0) return -1;
+
+    if (pthread_create(&thread, NULL, writer, NULL) != 0) {
+        sem_destroy(&ready);
+        return -1;
+    }
+    running = 1;
+    return 0;
+}
+
+/* Queue buffer as the next frame. Returns -1 if every slot is taken. */
+int pipeline_submit(long frame, long long deadline) {
+    size_t at = head;
+    if (at - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) >= PIPELINE_SLOTS)
+        return -1;
+
+    struct pipeline_slot *s = &slots[at % PIPELINE_SLOTS];
+    memcpy(s->cells, buffer, (size_t)canvas_rows * term_cols * sizeof(struct cell));
+    memcpy(s->lengths, line_length, canvas_rows * sizeof(size_t));
+    s->frame = frame;
+    s->deadline = deadline;
+
+    __atomic_store_n(&head, at + 1, __ATOMIC_RELEASE);
+    sem_post(&ready);
+    return 0;
+}
+
+/*
+ * Wait for the writer to finish everything queued, before the main thread
+ * touches the terminal, the screen model or the buffers itself, then take
+ * over the writer's statistics.
+ */
+void pipeline_drain(void) {
+    struct timespec ts = {0, 200000};
+
+    if (!running) return;
+    while (__atomic_load_n(&tail, __ATOMIC_ACQUIRE) != head) {
+        nanosleep(&ts, NULL);
+        stats_wakeup();
+    }
+    stats_merge(&writer_stats);
+}
+
+void pipeline_stop(void) {
+    if (running) {
+        pipeline_drain();
+        __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+        sem_post(&ready);
+        pthread_join(thread, NULL);
+        sem_destroy(&ready);
+        running = 0;
+    }
+
+    for (int i = 0; i < PIPELINE_SLOTS; i++) {
+        free(slots[i].cells);
+        free(slots[i].lengths);
+        slots[i].cells = NULL;
+        slots[i].lengths = NULL;
+    }
+}
@@ -0,0 +1,105 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "include/pool.h"
+#include "include/stats.h"
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER;
+
+static pthread_t *workers;
+static int worker_count;
+static unsigned long generation;
+static int stopping;
+
+static pool_job current_job;
+static void *current_arg;
+static int next_index, job_count, pending;
+
+static void drain(void) {
+    for (;;) {
+        int index = next_index < job_count ? next_index++ : -1;
+        if (index < 0) return;
+
+        pool_job job = current_job;
+        void *arg = current_arg;
+        pthread_mutex_unlock(&lock);
+        job(index, arg);
+        pthread_mutex_lock(&lock);
+
+        if (--pending == 0) pthread_cond_broadcast(&done);
+    }
+}
+
+static void *worker(void *unused) {
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&lock);
+    for (;;) {
+        while (generation == seen && !stopping) {
+            pthread_cond_wait(&work, &lock);
+            stats_wakeup();
+        }
+        if (stopping) break;
+
+        seen = generation;
+        drain();
+    }
+    pthread_mutex_unlock(&lock);
+    return unused;
+}
+
+int pool_start(int threads) {
+    if (workers || threads <= 1) return 0;
+
+    workers = calloc((size_t)threads - 1, sizeof(pthread_t));
+    if (!workers) return -1;
+
+    for (worker_count = 0; worker_count < threads - 1; worker_count++)
+        if (pthread_create(&workers[worker_count], NULL, worker, NULL) != 0)
+            break;
+
+    return 0;
+}
+
+void pool_run(pool_job job, void *arg, int count) {
+    if (worker_count == 0 || count <= 1) {
+        for (int i = 0; i < count; i++) job(i, arg);
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+    current_job = job;
+    current_arg = arg;
+    next_index = 0;
+    job_count = pending = count;
+    generation++;
+    pthread_cond_broadcast(&work);
+
+    drain();
+    while (pending > 0) {
+        pthread_cond_wait(&done, &lock);
+        stats_wakeup();
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void pool_stop(void) {
+    pthread_mutex_lock(&lock);
+    stopping = 1;
+    pthread_cond_broadcast(&work);
+    pthread_mutex_unlock(&lock);
+
+    for (int i = 0; i < worker_count; i++)
+        pthread_join(workers[i], NULL);
+
+    free(workers);
+    workers = NULL;
+    worker_count = 0;
+    stopping = 0;
+}
+
+int pool_threads(void) {
+    return worker_count + 1;
+}
@@ -0,0 +1,96 @@
+#include <dirent.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include "include/ghost.h"
+
+int power_save;
+
+static int divisor = 1;
+static long long checked = -1;
+
+void power_start(void) {
+#ifdef PR_SET_TIMERSLACK
+    prctl(PR_SET_TIMERSLACK, POWER_TIMER_SLACK_NS, 0, 0, 0);
+#endif
+}
+
+static FILE *open_sys(const char *path) {
+    const char *root = getenv("GHOST_SYSROOT");
+    char full[512];
+
+    snprintf(full, sizeof(full), "%s%s", root ? root : "", path);
+    return fopen(full, "r");
+}
+
+static int read_line(const char *path, char *out, size_t size) {
+    FILE *f = open_sys(path);
+    if (!f) return -1;
+
+    int ok = fgets(out, (int)size, f) != NULL;
+    fclose(f);
+    if (!ok) return -1;
+
+    out[strcspn(out, "\n")] = '\0';
+    return 0;
+}
+
+static int load_divisor(void) {
+    char line[128];
+    double load;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (read_line("/proc/loadavg", line, sizeof(line)) != 0 ||
+        sscanf(line, "%lf", &load) != 1)
+        return 1;
+
+    load /= cpus > 0 ? cpus : 1;
+    return load >= 2 * POWER_LOAD_HIGH ? 4 : load >= POWER_LOAD_HIGH ? 2 : 1;
+}
+
+static int battery_divisor(void) {
+    const char *root = getenv("GHOST_SYSROOT");
+    char dir[512], path[640], value[64];
+    int result = 1;
+
+    snprintf(dir, sizeof(dir), "%s/sys/class/power_supply", root ? root : "");
+    DIR *d = opendir(dir);
+    if (!d) return 1;
+
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+
+        snprintf(path, sizeof(path), "/sys/class/power_supply/%s/type", entry->d_name);
+        if (read_line(path, value, sizeof(value)) != 0 || strcmp(value, "Battery") != 0)
+            continue;
+
+        snprintf(path, sizeof(path), "/sys/class/power_supply/%s/status", entry->d_name);
+        if (read_line(path, value, sizeof(value)) != 0 || strcmp(value, "Discharging") != 0)
+            continue;
+
+        int level = 2;
+        snprintf(path, sizeof(path), "/sys/class/power_supply/%s/capacity", entry->d_name);
+        if (read_line(path, value, sizeof(value)) == 0 && atoi(value) <= POWER_BATTERY_LOW)
+            level = 4;
+        if (level > result) result = level;
+    }
+
+    closedir(d);
+    return result;
+}
+
+/*
+ * Draw every divisor-th frame slot. The files are read again at most once
+ * every POWER_CHECK_US, from within a frame's wakeup.
+ */
+int power_divisor(long long now) {
+    if (!power_save) return 1;
+    if (checked >= 0 && now - checked < POWER_CHECK_US) return divisor;
+
+    int load = load_divisor(), battery = battery_divisor();
+    divisor = load > battery ? load : battery;
+    checked = now;
+    return divisor;
+}
@@ -0,0 +1,67 @@
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "include/ghost.h"
+
+static struct decoder *target;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t thread;
+static sem_t wake;
+static int running, stopping, unavailable;
+
+static void *worker(void *unused) {
+    for (;;) {
+        while (sem_wait(&wake) != 0 && errno == EINTR)
+            ;
+        stats_wakeup();
+        if (__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) break;
+
+        pthread_mutex_lock(&lock);
+        decoder_ahead(target);
+        pthread_mutex_unlock(&lock);
+    }
+    return unused;
+}
+
+/* Returns 0 when the thread will decode ahead, -1 to do it inline. */
+int prefetch_ahead(struct decoder *d) {
+    if (!running) {
+        if (unavailable || frame_store || sysconf(_SC_NPROCESSORS_ONLN) < 2 ||
+            sem_init(&wake, 0, 0) != 0) {
+            unavailable = 1;
+            return -1;
+        }
+
+        target = d;
+        stopping = 0;
+        if (pthread_create(&thread, NULL, worker, NULL) != 0) {
+            sem_destroy(&wake);
+            unavailable = 1;
+            return -1;
+        }
+        running = 1;
+    }
+
+    sem_post(&wake);
+    return 0;
+}
+
+const struct frame_slot *prefetch_get(struct decoder *d, size_t index) {
+    if (!running) return decoder_get(d, index);
+
+    pthread_mutex_lock(&lock);
+    const struct frame_slot *frame = decoder_get(d, index);
+    pthread_mutex_unlock(&lock);
+    return frame;
+}
+
+void prefetch_stop(void) {
+    if (!running) return;
+
+    __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+    sem_post(&wake);
+    pthread_join(thread, NULL);
+    sem_destroy(&wake);
+    running = 0;
+}
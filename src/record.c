@@ -0,0 +1,186 @@
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "include/ghost.h"
+
+struct record_header {
+    long long time;
+    unsigned len;
+    char type;
+};
+
+static FILE *record_file;
+static char *ring;
+static size_t head, tail;
+static int stopping;
+static sem_t ready;
+static pthread_t thread;
+static long long origin;
+static unsigned long long dropped, dropped_bytes, unmarked;
+static int lost;
+
+static void copy_in(size_t pos, const void *src, size_t len) {
+    size_t at = pos & (RECORD_RING_SIZE - 1), first = RECORD_RING_SIZE - at;
+    if (first > len) first = len;
+
+    memcpy(ring + at, src, first);
+    memcpy(ring, (const char *)src + first, len - first);
+}
+
+static void copy_out(size_t pos, void *dst, size_t len) {
+    size_t at = pos & (RECORD_RING_SIZE - 1), first = RECORD_RING_SIZE - at;
+    if (first > len) first = len;
+
+    memcpy(dst, ring + at, first);
+    memcpy((char *)dst + first, ring, len - first);
+}
+
+/*
+ * Only the render thread moves head and only the writer moves tail. A record
+ * that does not fit is dropped rather than waited for.
+ */
+static void append(char type, const char *data, size_t len) {
+    struct record_header h = {get_microseconds() - origin, (unsigned)len, type};
+    size_t at = head;
+
+    copy_in(at, &h, sizeof(h));
+    copy_in(at + sizeof(h), data, len);
+    __atomic_store_n(&head, at + sizeof(h) + len, __ATOMIC_RELEASE);
+    sem_post(&ready);
+}
+
+static int gap_label(char *out, size_t size) {
+    return snprintf(out, size, "record dropped %llu bytes here", unmarked);
+}
+
+/* A gap is marked in the file right before the first record after it. */
+static void push(char type, const char *data, size_t len) {
+    char label[64];
+    size_t mark = unmarked ? sizeof(struct record_header) + (size_t)gap_label(label, sizeof(label)) : 0;
+    size_t free_bytes = RECORD_RING_SIZE - (head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE));
+
+    if (mark + sizeof(struct record_header) + len > free_bytes) {
+        dropped++;
+        dropped_bytes += len;
+        unmarked += len;
+        __atomic_store_n(&lost, 1, __ATOMIC_RELEASE);
+        return;
+    }
+
+    if (mark) append('m', label, mark - sizeof(struct record_header));
+    append(type, data, len);
+    unmarked = 0;
+}
+
+static void *writer(void *unused) {
+    char *data = NULL, *line = NULL;
+    size_t capacity = 0;
+
+    for (;;) {
+        while (sem_wait(&ready) != 0 && errno == EINTR)
+            ;
+        stats_wakeup();
+
+        size_t at = tail, end = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+        while (at != end) {
+            struct record_header h;
+            copy_out(at, &h, sizeof(h));
+
+            if (h.len > capacity) {
+                free(data);
+                free(line);
+                capacity = h.len;
+                data = malloc(capacity);
+                line = malloc(EXPORT_EVENT_SIZE(capacity));
+                if (!data || !line) abort();
+            }
+
+            copy_out(at + sizeof(h), data, h.len);
+            at += sizeof(h) + h.len;
+            __atomic_store_n(&tail, at, __ATOMIC_RELEASE);
+
+            char *ptr = export_event(line, h.time, h.type, data, h.len);
+            fwrite(line, 1, ptr - line, record_file);
+        }
+
+        if (__atomic_load_n(&stopping, __ATOMIC_ACQUIRE) &&
+            at == __atomic_load_n(&head, __ATOMIC_ACQUIRE))
+            break;
+    }
+
+    free(data);
+    free(line);
+    return unused;
+}
+
+int record_open(const char *path) {
+    record_file = fopen(path, "w");
+    return record_file ? 0 : -1;
+}
+
+int record_enabled(void) {
+    return record_file != NULL;
+}
+
+int record_start(int rows, int cols) {
+    if (!record_file || ring) return 0;
+
+    ring = malloc(RECORD_RING_SIZE);
+    if (!ring || sem_init(&ready, 0, 0) != 0) return -1;
+
+    origin = get_microseconds();
+    fprintf(record_file, "{\"version\": 2, \"width\": %d, \"height\": %d, \"timestamp\": %lld}\n",
+        cols, rows, (long long)time(NULL));
+
+    if (pthread_create(&thread, NULL, writer, NULL) != 0) {
+        free(ring);
+        ring = NULL;
+        return -1;
+    }
+
+    atexit(record_close);
+    return 0;
+}
+
+void record_output(const char *data, size_t len) {
+    if (ring && len > 0) push('o', data, len);
+}
+
+void record_resize(int rows, int cols) {
+    char size[32];
+
+    if (ring) push('r', size, (size_t)sprintf(size, "%dx%d", cols, rows));
+}
+
+/* Whether writes were dropped since the last call. */
+int record_lost(void) {
+    return __atomic_exchange_n(&lost, 0, __ATOMIC_ACQ_REL);
+}
+
+void record_close(void) {
+    if (!record_file) return;
+
+    if (ring) {
+        __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+        sem_post(&ready);
+        pthread_join(thread, NULL);
+        sem_destroy(&ready);
+        free(ring);
+        ring = NULL;
+    }
+
+    if (unmarked) {
+        char label[64], line[EXPORT_EVENT_SIZE(64)];
+        int n = gap_label(label, sizeof(label));
+        char *ptr = export_event(line, get_microseconds() - origin, 'm', label, (size_t)n);
+        fwrite(line, 1, ptr - line, record_file);
+    }
+
+    fclose(record_file);
+    record_file = NULL;
+
+    if (dropped)
+        fprintf(stderr, "record: dropped %llu writes (%llu bytes) while the disk was behind\n",
+            dropped, dropped_bytes);
+}
@@ -0,0 +1,214 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/simd.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIMD_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+static size_t ascii_run_scalar(const char *src, const char *end) {
+    const char *p = src;
+    while (p < end && (unsigned char)*p < 0x80 && *p != '\x1b') p++;
+    return (size_t)(p - src);
+}
+
+static void widen_scalar(struct cell *out, const char *src, size_t n, uint8_t fg) {
+    for (size_t i = 0; i < n; i++)
+        out[i] = (struct cell){(unsigned char)src[i], fg, 1};
+}
+
+static void fill_scalar(struct cell *out, struct cell c, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = c;
+}
+
+static size_t same_prefix_scalar(const struct cell *a, const struct cell *b, size_t n) {
+    size_t i = 0;
+    while (i < n && a[i].ch == b[i].ch && a[i].fg == b[i].fg && a[i].width == b[i].width)
+        i++;
+    return i;
+}
+
+#ifdef SIMD_X86
+
+/* A cell as one 32-bit lane; the layout in decoder.h has no padding. */
+static uint32_t cell_bits(struct cell c) {
+    return c.ch | (uint32_t)c.fg << 21 | (uint32_t)c.width << 29;
+}
+
+__attribute__((target("sse4.2")))
+static size_t ascii_run_sse42(const char *src, const char *end) {
+    const __m128i ranges = _mm_setr_epi8('\x1b', '\x1b', (char)0x80, (char)0xff,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    size_t i = 0, n = (size_t)(end - src);
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        int at = _mm_cmpestri(ranges, 4, v, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES);
+        if (at < 16) return i + (size_t)at;
+    }
+    return i + ascii_run_scalar(src + i, end);
+}
+
+__attribute__((target("sse4.2")))
+static void widen_sse42(struct cell *out, const char *src, size_t n, uint8_t fg) {
+    const __m128i attr = _mm_set1_epi32((int)cell_bits((struct cell){0, fg, 1}));
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        int32_t bytes;
+        memcpy(&bytes, src + i, 4);
+        __m128i ch = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_or_si128(ch, attr));
+    }
+    widen_scalar(out + i, src + i, n - i, fg);
+}
+
+__attribute__((target("sse4.2")))
+static void fill_sse42(struct cell *out, struct cell c, size_t n) {
+    const __m128i v = _mm_set1_epi32((int)cell_bits(c));
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_si128((__m128i *)(out + i), v);
+    fill_scalar(out + i, c, n - i);
+}
+
+__attribute__((target("sse4.2")))
+static size_t same_prefix_sse42(const struct cell *a, const struct cell *b, size_t n) {
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+        unsigned m = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, y)));
+        if (m != 0xf) return i + (size_t)__builtin_ctz(~m);
+    }
+    return i + same_prefix_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t ascii_run_avx2(const char *src, const char *end) {
+    const __m256i esc = _mm256_set1_epi8('\x1b');
+    size_t i = 0, n = (size_t)(end - src);
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(v, _mm256_cmpeq_epi8(v, esc)));
+        if (m) return i + (size_t)__builtin_ctz(m);
+    }
+    return i + ascii_run_scalar(src + i, end);
+}
+
+__attribute__((target("avx2")))
+static void widen_avx2(struct cell *out, const char *src, size_t n, uint8_t fg) {
+    const __m256i attr = _mm256_set1_epi32((int)cell_bits((struct cell){0, fg, 1}));
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i ch = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i)));
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_or_si256(ch, attr));
+    }
+    widen_scalar(out + i, src + i, n - i, fg);
+}
+
+__attribute__((target("avx2")))
+static void fill_avx2(struct cell *out, struct cell c, size_t n) {
+    const __m256i v = _mm256_set1_epi32((int)cell_bits(c));
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_si256((__m256i *)(out + i), v);
+    fill_scalar(out + i, c, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t same_prefix_avx2(const struct cell *a, const struct cell *b, size_t n) {
+    size_t i = 0;
+
+    /* Most stretches are short, so look at four cells before eight. */
+    if (n >= 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)a);
+        __m128i y = _mm_loadu_si128((const __m128i *)b);
+        unsigned m = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, y)));
+        if (m != 0xf) return (size_t)__builtin_ctz(~m);
+        i = 4;
+    }
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+        unsigned m = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(x, y)));
+        if (m != 0xff) return i + (size_t)__builtin_ctz(~m);
+    }
+    return i + same_prefix_scalar(a + i, b + i, n - i);
+}
+
+/* AVX2 also needs the OS to save the YMM registers, as XCR0 reports. */
+static int cpu_level(void) {
+    unsigned a, b, c, d;
+    int level = SIMD_SCALAR;
+
+    if (!__get_cpuid(1, &a, &b, &c, &d)) return level;
+    if ((c & bit_SSE4_1) && (c & bit_SSE4_2)) level = SIMD_SSE42;
+    if (level < SIMD_SSE42 || !(c & bit_OSXSAVE) || !(c & bit_AVX)) return level;
+
+    unsigned xcr0_lo, xcr0_hi;
+    __asm__ volatile ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6) != 6) return level;
+
+    if (__get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_AVX2)) level = SIMD_AVX2;
+    return level;
+}
+
+#else
+
+static int cpu_level(void) {
+    return SIMD_SCALAR;
+}
+
+#endif
+
+static const struct simd_kernels kernels[] = {
+    {ascii_run_scalar, widen_scalar, fill_scalar, same_prefix_scalar},
+#ifdef SIMD_X86
+    {ascii_run_sse42, widen_sse42, fill_sse42, same_prefix_sse42},
+    {ascii_run_avx2, widen_avx2, fill_avx2, same_prefix_avx2},
+#endif
+};
+
+struct simd_kernels simd = {ascii_run_scalar, widen_scalar, fill_scalar, same_prefix_scalar};
+
+static int supported = -1;
+
+int simd_supported(void) {
+    if (supported < 0) supported = cpu_level();
+    return supported;
+}
+
+/* Switch to the given level, or the best supported below it. */
+int simd_select(int level) {
+    if (level > simd_supported()) level = simd_supported();
+    if (level < SIMD_SCALAR) level = SIMD_SCALAR;
+    simd = kernels[level];
+    return level;
+}
+
+const char *simd_name(int level) {
+    static const char *const names[] = {"scalar", "sse4.2", "avx2"};
+    return level >= SIMD_SCALAR && level <= SIMD_AVX2 ? names[level] : "unknown";
+}
+
+/* GHOST_SIMD=scalar, sse4.2 or avx2 caps the level, for comparisons. */
+__attribute__((constructor))
+static void simd_init(void) {
+    const char *cap = getenv("GHOST_SIMD");
+    int level = SIMD_AVX2;
+
+    if (cap)
+        for (int i = SIMD_SCALAR; i <= SIMD_AVX2; i++)
+            if (strcmp(cap, simd_name(i)) == 0) level = i;
+    simd_select(level);
+}
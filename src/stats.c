@@ -0,0 +1,134 @@
+#include <string.h>
+#include <time.h>
+
+#include "include/fdio.h"
+#include "include/stats.h"
+
+static const char *phase_names[PHASE_COUNT] = {
+    "decode", "compose", "encode", "write", "input", "overshoot"
+};
+
+static struct stats_shard totals;
+static unsigned long long late_frames;
+static unsigned long long dropped_frames;
+static unsigned long long wakeups;
+static long long started;
+
+static unsigned int bucket_of(unsigned long long value) {
+    if (value < HIST_SUB_BUCKETS) return (unsigned int)value;
+
+    int msb = 63 - __builtin_clzll(value);
+    unsigned int sub = (unsigned int)(value >> (msb - HIST_SUB_BITS)) & (HIST_SUB_BUCKETS - 1);
+    return (unsigned int)(msb - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS + sub;
+}
+
+static unsigned long long bucket_limit(unsigned int bucket) {
+    if (bucket < HIST_SUB_BUCKETS) return bucket;
+
+    int msb = (int)(bucket / HIST_SUB_BUCKETS) + HIST_SUB_BITS - 1;
+    unsigned long long sub = bucket % HIST_SUB_BUCKETS;
+    return ((HIST_SUB_BUCKETS + sub + 1) << (msb - HIST_SUB_BITS)) - 1;
+}
+
+void hist_record(struct histogram *h, unsigned long long value) {
+    h->count++;
+    h->sum += value;
+    if (value > h->max) h->max = value;
+    h->buckets[bucket_of(value)]++;
+}
+
+static void hist_merge(struct histogram *h, const struct histogram *from) {
+    h->count += from->count;
+    h->sum += from->sum;
+    if (from->max > h->max) h->max = from->max;
+    for (unsigned int b = 0; b < HIST_BUCKETS; b++)
+        h->buckets[b] += from->buckets[b];
+}
+
+unsigned long long hist_percentile(const struct histogram *h, double p) {
+    if (h->count == 0) return 0;
+
+    unsigned long long rank = (unsigned long long)(p * h->count);
+    if (rank >= h->count) rank = h->count - 1;
+
+    unsigned long long seen = 0;
+    for (unsigned int b = 0; b < HIST_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen > rank) {
+            unsigned long long limit = bucket_limit(b);
+            return limit < h->max ? limit : h->max;
+        }
+    }
+    return h->max;
+}
+
+long long get_nanoseconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void stats_shard_phase(struct stats_shard *s, enum phase phase, long long ns) {
+    hist_record(&s->phases[phase], ns > 0 ? (unsigned long long)ns : 0);
+}
+
+void stats_shard_bytes(struct stats_shard *s, size_t bytes) {
+    hist_record(&s->bytes, bytes);
+}
+
+void stats_phase(enum phase phase, long long ns) {
+    if (!started) started = get_nanoseconds();
+    stats_shard_phase(&totals, phase, ns);
+}
+
+void stats_bytes(size_t bytes) {
+    stats_shard_bytes(&totals, bytes);
+}
+
+void stats_merge(struct stats_shard *s) {
+    for (int i = 0; i < PHASE_COUNT; i++)
+        hist_merge(&totals.phases[i], &s->phases[i]);
+    hist_merge(&totals.bytes, &s->bytes);
+    memset(s, 0, sizeof(*s));
+}
+
+void stats_late(void) {
+    late_frames++;
+}
+
+void stats_dropped(long long frames) {
+    __atomic_fetch_add(&dropped_frames, (unsigned long long)frames, __ATOMIC_RELAXED);
+}
+
+void stats_wakeup(void) {
+    __atomic_fetch_add(&wakeups, 1, __ATOMIC_RELAXED);
+}
+
+void stats_print(FILE *out) {
+    double seconds = started ? (get_nanoseconds() - started) / 1e9 : 0;
+
+    fprintf(out, "%-10s %10s %10s %10s %10s %10s\n",
+        "phase", "count", "p50 us", "p99 us", "max us", "total ms");
+
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const struct histogram *h = &totals.phases[i];
+        fprintf(out, "%-10s %10llu %10.1f %10.1f %10.1f %10.1f\n",
+            phase_names[i], h->count,
+            hist_percentile(h, 0.50) / 1e3, hist_percentile(h, 0.99) / 1e3,
+            h->max / 1e3, h->sum / 1e6);
+    }
+
+    fprintf(out, "%-10s %10llu %10llu %10llu %10llu %10llu\n",
+        "bytes", totals.bytes.count,
+        hist_percentile(&totals.bytes, 0.50), hist_percentile(&totals.bytes, 0.99),
+        totals.bytes.max, totals.bytes.sum);
+
+    fprintf(out, "%llu frames, %llu late, %llu dropped, %.0f bytes/s, %.1f wakeups/s over %.1f s\n",
+        totals.bytes.count, late_frames, __atomic_load_n(&dropped_frames, __ATOMIC_RELAXED),
+        seconds > 0 ? totals.bytes.sum / seconds : 0,
+        seconds > 0 ? __atomic_load_n(&wakeups, __ATOMIC_RELAXED) / seconds : 0, seconds);
+    fprintf(out, "io: %llu bytes out in %llu writes, %llu bytes in in %llu reads, %llu retries, %llu errors\n",
+        fdio_stats.bytes_out, fdio_stats.writes, fdio_stats.bytes_in, fdio_stats.reads,
+        fdio_stats.retries, __atomic_load_n(&fdio_stats.errors, __ATOMIC_RELAXED));
+    fflush(out);
+}
@@ -0,0 +1,155 @@
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "include/ghost.h"
+
+#define STORE_BUSY -2
+#define STORE_HEADER_SECONDS 5
+
+int shared_frames;
+
+static void *mapping;
+static size_t mapping_size;
+
+/* FNV-1a over the pack, seeded with the slot layout. */
+static unsigned long long pack_hash(void) {
+    unsigned long long h = 0xcbf29ce484222325ULL ^ sizeof(struct frame_slot);
+
+    for (unsigned int i = 0; i < frames_pack_size; i++) {
+        h ^= frames_pack[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/*
+ * Map an existing store. Returns 0 once it is mapped, otherwise the pid of
+ * its publisher if it is not ready yet, STORE_BUSY if its publisher has not
+ * written the header yet, or -1 if it cannot be used.
+ */
+static int map_store(int fd, unsigned long long hash) {
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || st.st_uid != geteuid()) return -1;
+
+    /* A header still missing after a few seconds will never be written. */
+    int fresh = time(NULL) - st.st_mtime < STORE_HEADER_SECONDS;
+    if ((size_t)st.st_size < sizeof(struct store_header))
+        return fresh ? STORE_BUSY : -1;
+    if ((size_t)st.st_size != mapping_size) return -1;
+
+    void *p = mmap(NULL, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return -1;
+
+    const struct store_header *h = p;
+    unsigned long long magic = __atomic_load_n(&h->magic, __ATOMIC_ACQUIRE);
+    if (magic == 0 && fresh) {
+        munmap(p, mapping_size);
+        return STORE_BUSY;
+    }
+
+    if (magic != STORE_MAGIC || h->hash != hash || h->frame_count != FRAME_COUNT ||
+        h->slot_size != sizeof(struct frame_slot)) {
+        munmap(p, mapping_size);
+        return -1;
+    }
+
+    if (!__atomic_load_n(&h->ready, __ATOMIC_ACQUIRE)) {
+        int publisher = h->publisher;
+        munmap(p, mapping_size);
+        return publisher > 0 ? publisher : -1;
+    }
+
+    mapping = p;
+    frame_store = (const struct frame_slot *)((char *)p + STORE_SLOTS_OFFSET);
+    return 0;
+}
+
+/* Only the used part of each slot is written, so the rest is never backed. */
+static int publish(int fd, unsigned long long hash) {
+    if (ftruncate(fd, (off_t)mapping_size) != 0) return -1;
+
+    void *p = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return -1;
+
+    /* The magic goes last, so a header with one is complete. */
+    struct store_header *h = p;
+    h->hash = hash;
+    h->publisher = (int)getpid();
+    h->frame_count = FRAME_COUNT;
+    h->slot_size = sizeof(struct frame_slot);
+    __atomic_store_n(&h->magic, STORE_MAGIC, __ATOMIC_RELEASE);
+
+    struct frame_slot *slots = (struct frame_slot *)((char *)p + STORE_SLOTS_OFFSET);
+    struct decoder *d = malloc(sizeof(*d));
+    int status = d ? 0 : -1;
+
+    if (d) decoder_reset(d);
+    for (size_t i = 0; status == 0 && i < FRAME_COUNT; i++) {
+        const struct frame_slot *frame = decoder_get(d, i);
+        if (!frame) {
+            status = -1;
+            break;
+        }
+
+        slots[i].frame = frame->frame;
+        memcpy(slots[i].offset, frame->offset, sizeof(frame->offset));
+        memcpy(slots[i].cells, frame->cells, frame->offset[IMAGE_HEIGHT] * sizeof(struct cell));
+    }
+    free(d);
+
+    if (status != 0) {
+        munmap(p, mapping_size);
+        return -1;
+    }
+
+    __atomic_store_n(&h->ready, 1, __ATOMIC_RELEASE);
+    mprotect(p, mapping_size, PROT_READ);
+    mapping = p;
+    frame_store = slots;
+    return 0;
+}
+
+int store_open(void) {
+    unsigned long long hash = pack_hash();
+    char name[64];
+
+    mapping_size = STORE_SLOTS_OFFSET + FRAME_COUNT * sizeof(struct frame_slot);
+    snprintf(name, sizeof(name), "/ghost-frames-%u-%016llx", (unsigned)geteuid(), hash);
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd >= 0) {
+            int r = map_store(fd, hash);
+            close(fd);
+            if (r == 0) return 0;
+            if (r == STORE_BUSY) return -1;
+            if (r > 0 && (kill(r, 0) == 0 || errno != ESRCH)) return -1;
+
+            shm_unlink(name);
+            continue;
+        }
+
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0400);
+        if (fd < 0) {
+            if (errno == EEXIST) continue;
+            return -1;
+        }
+
+        int r = publish(fd, hash);
+        if (r != 0) shm_unlink(name);
+        close(fd);
+        return r;
+    }
+
+    return -1;
+}
+
+void store_close(void) {
+    if (!mapping) return;
+
+    munmap(mapping, mapping_size);
+    mapping = NULL;
+    frame_store = NULL;
+}
@@ -0,0 +1,110 @@
+#include <math.h>
+
+#include "include/ghost.h"
+
+struct timeline timeline = {0, 0, 1, 0, 0};
+
+/* Times before the last anchor read as the anchor itself. */
+static double position_at(long long now) {
+    if (timeline.paused || now < timeline.origin) return timeline.position;
+    return timeline.position + (double)(now - timeline.origin) / MICROS_PER_FRAME * timeline.speed;
+}
+
+static void anchor(long long now) {
+    timeline.position = position_at(now);
+    timeline.origin = now;
+}
+
+void timeline_start(long long now) {
+    timeline.origin = now;
+    timeline.position = 0;
+}
+
+long long timeline_tick(long long now) {
+    return (long long)floor(position_at(now));
+}
+
+/*
+ * The first microsecond at which the tick has changed, or -1 while paused.
+ * It is measured from the anchor so that it lands exactly on a frame
+ * boundary at speed 1, then moved onto the microsecond where position_at
+ * itself crosses it, which rounding can put one either side.
+ */
+long long timeline_next(long long now) {
+    if (timeline.paused) return -1;
+
+    double tick = floor(position_at(now));
+    double boundary = timeline.speed > 0 ? tick + 1 : tick;
+    double wait = (boundary - timeline.position) / timeline.speed * MICROS_PER_FRAME;
+    long long next = timeline.origin + (long long)ceil(wait);
+
+    if (next <= now) next = now + 1;
+    while (next > now + 1 && floor(position_at(next - 1)) != tick)
+        next--;
+    while (floor(position_at(next)) == tick)
+        next++;
+    return next;
+}
+
+size_t timeline_frame(long long position) {
+    if (!timeline.pingpong)
+        return (size_t)((position % FRAME_COUNT + FRAME_COUNT) % FRAME_COUNT);
+
+    long long period = 2 * (FRAME_COUNT - 1);
+    long long m = (position % period + period) % period;
+    return (size_t)(m < FRAME_COUNT ? m : period - m);
+}
+
+/*
+ * Whether the next frame played from this position, in the direction of
+ * play, is the one after it in the pack, which is the one decoded ahead.
+ */
+int timeline_forward(long long position) {
+    size_t next = timeline_frame(position + (timeline.speed > 0 ? 1 : -1));
+    return next == (timeline_frame(position) + 1) % FRAME_COUNT;
+}
+
+void timeline_pause(long long now) {
+    anchor(now);
+    timeline.paused = !timeline.paused;
+}
+
+void timeline_step(long long now, long long frames) {
+    anchor(now);
+    timeline.paused = 1;
+    timeline.position = floor(timeline.position) + frames;
+}
+
+void timeline_seek(long long now, long long frames) {
+    anchor(now);
+    timeline.position += frames;
+}
+
+void timeline_speed(long long now, double factor) {
+    double speed = fabs(timeline.speed) * factor;
+
+    if (speed < TIMELINE_SPEED_MIN) speed = TIMELINE_SPEED_MIN;
+    if (speed > TIMELINE_SPEED_MAX) speed = TIMELINE_SPEED_MAX;
+
+    anchor(now);
+    timeline.speed = timeline.speed < 0 ? -speed : speed;
+}
+
+void timeline_reverse(long long now) {
+    anchor(now);
+    timeline.speed = -timeline.speed;
+}
+
+/*
+ * Switching ping-pong on or off changes how positions map to frames, so the
+ * position is moved to one that shows the same frame.
+ */
+void timeline_pingpong(long long now) {
+    anchor(now);
+
+    double p = timeline.position, tick = floor(p);
+    long long frame = (long long)timeline_frame((long long)tick + frame_offset);
+
+    timeline.pingpong = !timeline.pingpong;
+    timeline.position = frame - frame_offset + (p - tick);
+}
@@ -0,0 +1,113 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "include/stats.h"
+#include "include/trace.h"
+
+static struct trace_event *events;
+static unsigned long long recorded;
+static long long origin;
+static FILE *trace_file;
+static pthread_t main_thread;
+
+static struct trace_event *trace_next(const char *name, char type, long long ts) {
+    unsigned long long n = __atomic_fetch_add(&recorded, 1, __ATOMIC_RELAXED);
+    struct trace_event *e = &events[n % TRACE_EVENTS];
+
+    *e = (struct trace_event){
+        .name = name, .type = type, .ts = ts - origin,
+        .frame = -1, .bytes = -1, .deadline = -1, .count = -1,
+        .tid = pthread_equal(pthread_self(), main_thread) ? 1 : 2
+    };
+    return e;
+}
+
+int trace_open(const char *path) {
+    trace_file = fopen(path, "w");
+    if (!trace_file) return -1;
+
+    events = malloc(TRACE_EVENTS * sizeof(*events));
+    if (!events) {
+        fclose(trace_file);
+        trace_file = NULL;
+        return -1;
+    }
+
+    main_thread = pthread_self();
+    origin = get_nanoseconds();
+    atexit(trace_close);
+    return 0;
+}
+
+int trace_enabled(void) {
+    return events != NULL;
+}
+
+void trace_span(const char *name, long long start, long long end, long frame) {
+    if (!events) return;
+
+    struct trace_event *e = trace_next(name, 'X', start);
+    e->dur = end - start;
+    e->frame = frame;
+}
+
+void trace_present(long long start, long long end, long frame,
+                   size_t bytes, long long deadline) {
+    if (!events) return;
+
+    struct trace_event *e = trace_next("present", 'X', start);
+    e->dur = end - start;
+    e->frame = frame;
+    e->bytes = (long long)bytes;
+    e->deadline = deadline;
+}
+
+void trace_drop(long long ts, long frame, long long dropped) {
+    if (!events) return;
+
+    struct trace_event *e = trace_next("drop", 'i', ts);
+    e->frame = frame;
+    e->count = dropped;
+}
+
+static void write_event(FILE *f, const struct trace_event *e) {
+    fprintf(f, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,", e->name, e->type, e->ts / 1e3);
+    if (e->type == 'X')
+        fprintf(f, "\"dur\":%.3f,", e->dur / 1e3);
+    else
+        fprintf(f, "\"s\":\"t\",");
+    fprintf(f, "\"pid\":1,\"tid\":%d,\"args\":{\"frame\":%ld", e->tid, e->frame);
+
+    if (e->bytes >= 0)
+        fprintf(f, ",\"bytes\":%lld", e->bytes);
+    if (e->deadline >= 0)
+        fprintf(f, ",\"deadline_us\":%.3f,\"present_us\":%.3f,\"late_us\":%.3f",
+            (e->deadline - origin) / 1e3, (e->ts + e->dur) / 1e3,
+            (e->ts + e->dur - (e->deadline - origin)) / 1e3);
+    if (e->count >= 0)
+        fprintf(f, ",\"dropped\":%lld", e->count);
+    fprintf(f, "}}");
+}
+
+void trace_close(void) {
+    if (!trace_file) return;
+
+    unsigned long long first = recorded > TRACE_EVENTS ? recorded - TRACE_EVENTS : 0;
+
+    fprintf(trace_file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(trace_file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+        "\"args\":{\"name\":\"ghost\"}}");
+    fprintf(trace_file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,"
+        "\"args\":{\"name\":\"writer\"}}");
+    for (unsigned long long i = first; i < recorded; i++) {
+        fprintf(trace_file, ",\n");
+        write_event(trace_file, &events[i % TRACE_EVENTS]);
+    }
+    fprintf(trace_file, "\n]}\n");
+
+    fclose(trace_file);
+    trace_file = NULL;
+    free(events);
+    events = NULL;
+}
@@ -0,0 +1,933 @@
+#include <math.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "include/ghost.h"
+#include "include/vt.h"
+
+struct geometry {
+    int rows, cols;
+};
+
+static const struct geometry geometries[] = {
+    {56, 115}, {60, 120}, {57, 116}, {80, 240}, {120, 400},
+};
+
+struct wall_geometry {
+    int rows, cols;
+    int top;            /* first terminal row of the canvas, counted from 0 */
+};
+
+struct placement {
+    int rows, cols;
+    int row, col;
+};
+
+static const struct placement placements[] = {
+    {60, 120, 1, -1}, {50, 100, -1, 1}, {70, 150, 10, 30},
+};
+
+static int expected_row(const char *line, uint32_t *ch, uint8_t *fg, int max) {
+    int cols = 0;
+    uint8_t color = 0;
+
+    while (*line && cols < max) {
+        if (strncmp(line, "<color>", 7) == 0) {
+            color = 34;
+            line += 7;
+            continue;
+        }
+        if (strncmp(line, "</color>", 8) == 0) {
+            color = 0;
+            line += 8;
+            continue;
+        }
+
+        uint32_t cp;
+        line += utf8_decode(line, line + 4, &cp);
+
+        int width = char_width(cp);
+        if (width == 0) continue;
+        if (cols + width > max) {
+            ch[cols] = ' ';
+            fg[cols++] = 0;
+            break;
+        }
+
+        ch[cols] = cp;
+        fg[cols++] = color;
+        if (width == 2) {
+            ch[cols] = 0;
+            fg[cols++] = color;
+        }
+    }
+
+    return cols;
+}
+
+static int same_cell(const struct vt_cell *cell, uint32_t ch, uint8_t fg) {
+    return cell->ch == ch && (ch == ' ' || cell->fg == fg);
+}
+
+static int check_frame(const struct vt *vt, size_t frame, int verbose) {
+    uint32_t ch[PACK_ROW_MAX];
+    uint8_t fg[PACK_ROW_MAX];
+    int bad = 0;
+
+    for (int i = 0; i < IMAGE_HEIGHT; i++) {
+        int row = start_row + i - 1;
+
+        int width = expected_row(animation_row((int)frame, i), ch, fg, PACK_ROW_MAX);
+
+        for (int col = 0; col < vt->cols; col++) {
+            int k = col - start_col;
+            uint32_t want = k >= 0 && k < width ? ch[k] : ' ';
+            uint8_t want_fg = k >= 0 && k < width ? fg[k] : 0;
+            const struct vt_cell *got = vt_cell(vt, row, col);
+
+            if (same_cell(got, want, want_fg)) continue;
+            if (verbose && bad < 5)
+                fprintf(stderr,
+                    "  frame %zu row %d col %d: expected U+%04X fg %d, got U+%04X fg %d\n",
+                    frame, i, col, want, want_fg, got->ch, got->fg);
+            bad++;
+        }
+    }
+
+    return bad;
+}
+
+static int verify_geometry(const struct geometry *g, int verbose) {
+    struct vt vt;
+    int failed = 0;
+
+    term_rows = g->rows;
+    term_cols = g->cols;
+    center_image();
+
+    if (load_frames() != 0 || alloc_buffers() != 0 ||
+        vt_init(&vt, g->rows, g->cols) != 0)
+        return -1;
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < FRAME_COUNT; i++) {
+            size_t f = pass == 0 ? i : i * 7919 % FRAME_COUNT;
+            const struct frame_slot *frame = get_frame(f);
+            if (!frame) {
+                vt_free(&vt);
+                return -1;
+            }
+
+            compose_frame(frame);
+            size_t len = encode_frame(output);
+            vt_feed(&vt, output, len);
+            decode_ahead();
+
+            if (check_frame(&vt, f, verbose && failed == 0)) failed++;
+        }
+    }
+
+    printf("%3dx%-4d %s: %d of %d frames differ, %llu unknown sequences\n",
+        g->cols, g->rows, failed || vt.unknown ? "FAIL" : "ok",
+        failed, 2 * FRAME_COUNT, vt.unknown);
+
+    int status = failed || vt.unknown ? 1 : 0;
+    vt_free(&vt);
+    return status;
+}
+
+static int check_overlay(const struct vt *vt, int frame, int row0, int col0,
+                         uint8_t fg0, int verbose) {
+    uint32_t ch[PACK_ROW_MAX];
+    uint8_t fg[PACK_ROW_MAX];
+    int bad = 0;
+
+    for (int r = 0; r < vt->rows; r++) {
+        int i = r - (start_row - 1);
+        int width = 0;
+        if (frame >= 0 && i >= 0 && i < IMAGE_HEIGHT)
+            width = expected_row(animation_row(frame, i), ch, fg, PACK_ROW_MAX);
+
+        for (int col = 0; col < vt->cols; col++) {
+            int k = col - start_col;
+            const struct vt_cell *got = vt_cell(vt, r, col);
+            int ok;
+
+            if (k >= 0 && k < width && ch[k] != ' ')
+                ok = same_cell(got, ch[k], fg[k]);
+            else if (i >= 0 && i < IMAGE_HEIGHT && k >= 0)
+                ok = got->ch == '.' || got->ch == ' ';
+            else
+                ok = got->ch == '.';
+
+            if (ok) continue;
+            if (verbose && bad < 5)
+                fprintf(stderr, "  overlay frame %d row %d col %d: got U+%04X\n",
+                    frame, r, col, got->ch);
+            bad++;
+        }
+    }
+
+    if (vt->row != row0 || vt->col != col0 || vt->fg != fg0) {
+        if (verbose)
+            fprintf(stderr, "  overlay frame %d: cursor %d,%d fg %d not restored\n",
+                frame, vt->row, vt->col, vt->fg);
+        bad++;
+    }
+
+    return bad;
+}
+
+static int verify_overlay(const struct placement *p, int verbose) {
+    struct vt vt;
+    int failed = 0;
+    char line[64];
+
+    overlay = 1;
+    overlay_row = p->row;
+    overlay_col = p->col;
+    term_rows = p->rows;
+    term_cols = p->cols;
+    place_image();
+
+    if (load_frames() != 0 || alloc_buffers() != 0 ||
+        vt_init(&vt, p->rows, p->cols) != 0)
+        return -1;
+
+    for (int r = 0; r < p->rows; r++)
+        for (int c = 0; c < p->cols; c++)
+            vt_feed(&vt, ".", 1);
+    snprintf(line, sizeof(line), "\x1b[%d;5H\x1b[32m", p->rows - 2);
+    vt_feed(&vt, line, strlen(line));
+
+    int row0 = vt.row, col0 = vt.col;
+    uint8_t fg0 = vt.fg;
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < FRAME_COUNT; i++) {
+            size_t f = pass == 0 ? i : i * 7919 % FRAME_COUNT;
+            const struct frame_slot *frame = get_frame(f);
+            if (!frame) {
+                vt_free(&vt);
+                return -1;
+            }
+
+            compose_frame(frame);
+            vt_feed(&vt, output, encode_frame(output));
+            decode_ahead();
+
+            if (check_overlay(&vt, (int)f, row0, col0, fg0, verbose && failed == 0))
+                failed++;
+        }
+    }
+
+    vt_feed(&vt, output, encode_clear(output));
+    if (check_overlay(&vt, -1, row0, col0, fg0, verbose && failed == 0)) failed++;
+
+    printf("%3dx%-4d %s: overlay at %d,%d, %d of %d frames differ, %llu unknown sequences\n",
+        p->cols, p->rows, failed || vt.unknown ? "FAIL" : "ok", p->row, p->col,
+        failed, 2 * FRAME_COUNT + 1, vt.unknown);
+
+    int status = failed || vt.unknown ? 1 : 0;
+    vt_free(&vt);
+    overlay = 0;
+    return status;
+}
+
+static const double wall_speeds[] = {1, 0.5, 2, 3};
+
+static int check_wall(const struct vt *vt, int top, long long tick, int verbose) {
+    uint32_t ch[PACK_ROW_MAX];
+    uint8_t fg[PACK_ROW_MAX];
+    uint32_t want[1024];
+    uint8_t want_fg[1024];
+    int tiles = grid_rows * grid_cols, bad = 0;
+
+    for (int i = 0; i < canvas_rows; i++) {
+        int r = i % TILE_HEIGHT;
+
+        for (int col = 0; col < vt->cols; col++) {
+            want[col] = ' ';
+            want_fg[col] = 0;
+        }
+
+        for (int gc = 0; r < IMAGE_HEIGHT && gc < grid_cols; gc++) {
+            int t = i / TILE_HEIGHT * grid_cols + gc;
+            long long step = (long long)(tick * wall_speeds[t % 4]);
+            size_t f = (size_t)((step + (long long)t * FRAME_COUNT / tiles) % FRAME_COUNT);
+            int col = start_col + gc * TILE_WIDTH;
+            int max = gc + 1 < grid_cols ? TILE_WIDTH : vt->cols - col;
+            int width = expected_row(animation_row((int)f, r), ch, fg, max);
+
+            memcpy(want + col, ch, width * sizeof(uint32_t));
+            memcpy(want_fg + col, fg, width);
+        }
+
+        for (int col = 0; col < vt->cols; col++) {
+            const struct vt_cell *got = vt_cell(vt, top + i, col);
+            if (same_cell(got, want[col], want_fg[col])) continue;
+            if (verbose && bad < 5)
+                fprintf(stderr, "  wall tick %lld row %d col %d: expected U+%04X, got U+%04X\n",
+                    tick, i, col, want[col], got->ch);
+            bad++;
+        }
+    }
+
+    return bad;
+}
+
+static int verify_wall(const struct wall_geometry *g, int verbose) {
+    struct vt vt;
+    int failed = 0;
+
+    wall = 1;
+    wall_parse_speeds("1,0.5,2,3");
+    term_rows = g->rows;
+    term_cols = g->cols;
+    wall_grid();
+    center_image();
+
+    if (load_frames() != 0 || alloc_buffers() != 0 ||
+        vt_init(&vt, g->rows, g->cols) != 0)
+        return -1;
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (long long i = 0; i < FRAME_COUNT; i++) {
+            long long tick = pass == 0 ? i : i * 7919;
+            if (wall_decode(tick) != 0) {
+                vt_free(&vt);
+                return -1;
+            }
+
+            wall_compose();
+            vt_feed(&vt, output, wall_encode(output));
+            wall_ahead();
+
+            if (check_wall(&vt, g->top, tick, verbose && failed == 0)) failed++;
+        }
+    }
+
+    printf("%3dx%-4d %s: wall of %dx%d, %d of %d frames differ, %llu unknown sequences\n",
+        g->cols, g->rows, failed || vt.unknown ? "FAIL" : "ok", grid_cols, grid_rows,
+        failed, 2 * FRAME_COUNT, vt.unknown);
+
+    int status = failed || vt.unknown ? 1 : 0;
+    vt_free(&vt);
+    wall = 0;
+    set_grid(1, 1);
+    return status;
+}
+
+/* Undo the JSON string escapes the exporter uses. Returns -1 on anything else. */
+static long unescape(const char *s, char *out) {
+    char *ptr = out;
+
+    while (*s != '"') {
+        if (*s == '\0') return -1;
+        if (*s != '\\') {
+            *ptr++ = *s++;
+            continue;
+        }
+
+        unsigned code;
+        switch (s[1]) {
+        case 'n': *ptr++ = '\n'; s += 2; break;
+        case 'r': *ptr++ = '\r'; s += 2; break;
+        case '"': case '\\': *ptr++ = s[1]; s += 2; break;
+        case 'u':
+            if (sscanf(s + 2, "%4x", &code) != 1 || code > 0x7f) return -1;
+            *ptr++ = (char)code;
+            s += 6;
+            break;
+        default:
+            return -1;
+        }
+    }
+
+    return s[1] == ']' ? ptr - out : -1;
+}
+
+/*
+ * Export a cast, replay its events through the terminal model and check
+ * that each one leaves the frame due at its timestamp on the screen.
+ */
+static int same_contents(const char *a, const char *b) {
+    FILE *fa = fopen(a, "r"), *fb = fopen(b, "r");
+    int same = fa && fb, ca, cb;
+
+    while (same && (ca = getc(fa)) == (cb = getc(fb)))
+        if (ca == EOF) break;
+    same = same && ca == cb;
+
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return same;
+}
+
+static int verify_export(const struct geometry *g, double fps, int verbose) {
+    char path[] = "/tmp/ghost-verify-XXXXXX", dumb[] = "/tmp/ghost-verify-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return -1;
+    close(fd);
+    if ((fd = mkstemp(dumb)) < 0) {
+        remove(path);
+        return -1;
+    }
+    close(fd);
+
+    /* The second export runs as if TERM were dumb, which must not matter. */
+    export_fps = fps;
+    export_rows = g->rows;
+    export_cols = g->cols;
+    export_path = path;
+    rep_supported = 1;
+    int r = load_frames() != 0 || export_run() != 0;
+    export_path = dumb;
+    rep_supported = 0;
+    r = r || export_run() != 0;
+    int same = !r && same_contents(path, dumb);
+    remove(dumb);
+    if (r) {
+        remove(path);
+        return -1;
+    }
+
+    struct vt vt;
+    FILE *f = fopen(path, "r");
+    char *line = NULL, *data = NULL;
+    size_t cap = 0;
+    int width, height, events = 0, failed = 0, status = -1;
+
+    if (!f || vt_init(&vt, g->rows, g->cols) != 0) goto out;
+    if (getline(&line, &cap, f) < 0 ||
+        sscanf(line, "{\"version\": 2, \"width\": %d, \"height\": %d}", &width, &height) != 2 ||
+        width != g->cols || height != g->rows)
+        goto done;
+
+    while (getline(&line, &cap, f) > 0) {
+        double t;
+        int n = 0;
+        long len;
+
+        if (sscanf(line, "[%lf, \"o\", \"%n", &t, &n) != 1 || n == 0) goto done;
+        free(data);
+        data = malloc(strlen(line));
+        if (!data || (len = unescape(line + n, data)) < 0) goto done;
+
+        vt_feed(&vt, data, (size_t)len);
+        long long tick = llround(t * 1000000) / MICROS_PER_FRAME;
+        if (check_frame(&vt, (size_t)(tick % FRAME_COUNT), verbose && failed == 0)) failed++;
+        events++;
+    }
+
+    if (!same && verbose) fprintf(stderr, "  cast depends on TERM\n");
+    printf("%3dx%-4d %s: cast at %g fps, %d of %d events differ, %llu unknown sequences%s\n",
+        g->cols, g->rows, failed || vt.unknown || !same ? "FAIL" : "ok", fps,
+        failed, events, vt.unknown, same ? "" : ", depends on TERM");
+    status = failed || vt.unknown || !same ? 1 : 0;
+
+done:
+    vt_free(&vt);
+out:
+    if (f) fclose(f);
+    free(line);
+    free(data);
+    remove(path);
+    return status;
+}
+
+struct lib_check {
+    struct geometry g;
+    const char *color;
+    int verbose;
+    int failed, status;
+    unsigned long long unknown;
+};
+
+static int check_lib_frame(const struct vt *vt, const struct lib_check *c, size_t frame,
+                           uint8_t color, int verbose) {
+    uint32_t ch[PACK_ROW_MAX];
+    uint8_t fg[PACK_ROW_MAX];
+    int top = (c->g.rows - IMAGE_HEIGHT) / 2;
+    int left = (c->g.cols - (int)pack.width) / 2;
+    int bad = 0;
+
+    for (int r = 0; r < vt->rows; r++) {
+        int i = r - top;
+        int width = 0;
+        if (i >= 0 && i < IMAGE_HEIGHT)
+            width = expected_row(animation_row((int)frame, i), ch, fg, PACK_ROW_MAX);
+
+        for (int col = 0; col < vt->cols; col++) {
+            int k = col - left;
+            uint32_t want = k >= 0 && k < width ? ch[k] : ' ';
+            uint8_t want_fg = k >= 0 && k < width && fg[k] ? color : 0;
+
+            /* The library blanks glyphs cut in half by the box. */
+            if ((want == 0 && col == 0) ||
+                (k + 1 < width && ch[k + 1] == 0 && col + 1 == vt->cols))
+                want = ' ';
+
+            const struct vt_cell *got = vt_cell(vt, r, col);
+            if (same_cell(got, want, want_fg)) continue;
+            if (verbose && bad < 5)
+                fprintf(stderr, "  libghost frame %zu row %d col %d: want U+%04X fg %d, got U+%04X fg %d\n",
+                    frame, r, col, want, want_fg, got->ch, got->fg);
+            bad++;
+        }
+    }
+
+    return bad;
+}
+
+/*
+ * Render every frame with libghost, in order and then scattered, and check
+ * the text against src/frames.c as it lands on a terminal.
+ */
+static void *verify_lib(void *arg) {
+    struct lib_check *c = arg;
+    struct ghost_geometry geometry = {c->g.rows, c->g.cols};
+    struct ghost_theme theme = {c->color};
+    struct ghost_ctx *ctx = ghost_ctx_init(&geometry, &theme);
+    uint8_t color = c->color ? (uint8_t)atoi(c->color) : 34;
+    struct vt vt;
+
+    c->status = -1;
+    if (!ctx) return NULL;
+
+    size_t cap = ghost_frame_size(ctx);
+    char *text = malloc(cap), *data = malloc(2 * cap + 8);
+    if (!text || !data || vt_init(&vt, c->g.rows, c->g.cols) != 0) goto out;
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < FRAME_COUNT; i++) {
+            size_t f = pass == 0 ? i : i * 7919 % FRAME_COUNT;
+            long len = ghost_render_frame(ctx, (int)f, text, cap);
+            if (len <= 0) {
+                vt_free(&vt);
+                goto out;
+            }
+
+            /* The last newline is dropped so the screen does not scroll. */
+            char *ptr = data + sprintf(data, "\x1b[H\x1b[2J");
+            for (long k = 0; k < len - 1; k++) {
+                if (text[k] == '\n') *ptr++ = '\r';
+                *ptr++ = text[k];
+            }
+            vt_feed(&vt, data, (size_t)(ptr - data));
+
+            if (check_lib_frame(&vt, c, f, color, c->verbose && c->failed == 0)) c->failed++;
+        }
+    }
+
+    c->unknown = vt.unknown;
+    c->status = c->failed || vt.unknown ? 1 : 0;
+    vt_free(&vt);
+out:
+    free(text);
+    free(data);
+    ghost_ctx_free(ctx);
+    return NULL;
+}
+
+static int same_cells(const struct cell *a, const struct cell *b, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        if (a[i].ch != b[i].ch || a[i].fg != b[i].fg || a[i].width != b[i].width) return 0;
+    return 1;
+}
+
+/*
+ * Check each kernel variant the CPU supports against the scalar one, for
+ * every length and mismatch position up to a few vectors.
+ */
+static int verify_simd(int level, int verbose) {
+    enum { N = 70 };
+    struct simd_kernels ref, test;
+    char text[N];
+    struct cell a[N + 1], b[N + 1], c[N + 1];
+    int failed = 0, cases = 0;
+
+    simd_select(SIMD_SCALAR);
+    ref = simd;
+    if (simd_select(level) != level) return 0;
+    test = simd;
+
+    for (int len = 0; len <= N; len++) {
+        for (int pos = 0; pos <= len; pos++) {
+            for (int k = 0; k < 3; k++) {
+                for (int i = 0; i < N; i++) text[i] = (char)(' ' + (i * 7 + len) % 94);
+                if (pos < len) text[pos] = "\x1b\x80\xc3"[k];
+
+                cases++;
+                if (test.ascii_run(text, text + len) != ref.ascii_run(text, text + len)) {
+                    if (verbose && failed < 5)
+                        fprintf(stderr, "  %s ascii_run: length %d, byte at %d\n",
+                            simd_name(level), len, pos);
+                    failed++;
+                }
+
+                memset(a, 0x5a, sizeof(a));
+                for (int i = 0; i < len; i++) a[i] = (struct cell){text[i] & 0x7f, (uint8_t)(30 + k), 1};
+                memcpy(b, a, sizeof(b));
+                memset(c, 0xa5, sizeof(c));
+                if (pos < len) {
+                    if (k == 0) b[pos].ch++;
+                    else if (k == 1) b[pos].fg++;
+                    else b[pos].width++;
+                }
+
+                cases++;
+                if (test.same_prefix(a, b, (size_t)len) != ref.same_prefix(a, b, (size_t)len)) {
+                    if (verbose && failed < 5)
+                        fprintf(stderr, "  %s same_prefix: length %d, change at %d\n",
+                            simd_name(level), len, pos);
+                    failed++;
+                }
+            }
+        }
+
+        for (int i = 0; i < N; i++) text[i] = (char)(' ' + (i * 13 + len) % 94);
+        memset(a, 0x5a, sizeof(a));
+        memset(b, 0x5a, sizeof(b));
+        ref.widen(a, text, (size_t)len, (uint8_t)len);
+        test.widen(b, text, (size_t)len, (uint8_t)len);
+        cases++;
+        if (!same_cells(a, b, (size_t)len + 1)) {
+            if (verbose && failed < 5)
+                fprintf(stderr, "  %s widen: length %d\n", simd_name(level), len);
+            failed++;
+        }
+
+        struct cell fill = {0x1f47b, (uint8_t)len, 2};
+        ref.fill(a, fill, (size_t)len);
+        test.fill(b, fill, (size_t)len);
+        cases++;
+        if (!same_cells(a, b, (size_t)len + 1)) {
+            if (verbose && failed < 5)
+                fprintf(stderr, "  %s fill: length %d\n", simd_name(level), len);
+            failed++;
+        }
+    }
+
+    printf("%-8s %s: %d of %d kernel cases differ from scalar\n",
+        simd_name(level), failed ? "FAIL" : "ok", failed, cases);
+    return failed ? 1 : 0;
+}
+
+#define PERIOD (2 * (FRAME_COUNT - 1))
+
+struct frame_case {
+    long long position;
+    size_t loop, pingpong;
+};
+
+static const struct frame_case frame_cases[] = {
+    {0, 0, 0}, {FRAME_COUNT - 1, FRAME_COUNT - 1, FRAME_COUNT - 1},
+    {FRAME_COUNT, 0, FRAME_COUNT - 2}, {PERIOD - 1, FRAME_COUNT - 3, 1},
+    {PERIOD, FRAME_COUNT - 2, 0}, {-1, FRAME_COUNT - 1, 1},
+    {-(FRAME_COUNT - 1), 1, FRAME_COUNT - 1}, {-PERIOD, 2, 0}, {-PERIOD - 1, 1, 1},
+    {3 * PERIOD + 5, FRAME_COUNT - 1, 5},
+};
+
+struct forward_case {
+    int pingpong;
+    double speed;
+    long long position;
+    int forward;
+};
+
+static const struct forward_case forward_cases[] = {
+    {0, 1, 5, 1}, {0, 1, FRAME_COUNT - 1, 1}, {0, -1, 5, 0}, {0, -1, 0, 0},
+    {1, 1, 0, 1}, {1, 1, FRAME_COUNT - 2, 1}, {1, 1, FRAME_COUNT - 1, 0},
+    {1, 1, PERIOD - 1, 0}, {1, 1, -1, 0}, {1, 1, -PERIOD, 1},
+    {1, -1, 0, 1}, {1, -1, 5, 0}, {1, -1, FRAME_COUNT - 1, 0},
+    {1, -1, FRAME_COUNT, 1}, {1, -1, -1, 1}, {1, -1, -(FRAME_COUNT - 1), 0},
+};
+
+static const double timeline_speeds[] = {0.125, -0.125, 1, -1, 8, -8};
+static const double timeline_starts[] = {0, 0.3, -0.7, 5.999, 234.5, -100.25};
+static const long long pingpong_ticks[] = {
+    0, FRAME_COUNT - 1, FRAME_COUNT, PERIOD - 1, PERIOD, -1, -(FRAME_COUNT - 1),
+    -PERIOD, 2 * PERIOD + FRAME_COUNT - 1,
+};
+
+static int timeline_case(int ok, int *failed, int verbose, const char *what,
+                         double speed, double at) {
+    if (ok) return 1;
+    if (verbose && *failed < 5)
+        fprintf(stderr, "  timeline %s: speed %g at %g\n", what, speed, at);
+    (*failed)++;
+    return 0;
+}
+
+/*
+ * Check the frame each position maps to, the direction the decoder reads
+ * ahead in, that timeline_next lands on the first microsecond of the next
+ * tick at each speed, and that toggling ping-pong at either end of the
+ * period keeps the frame on screen.
+ */
+static int verify_timeline(int verbose) {
+    struct timeline saved = timeline;
+    long long saved_offset = frame_offset;
+    int failed = 0, cases = 0;
+
+    for (size_t i = 0; i < sizeof(frame_cases) / sizeof(frame_cases[0]); i++) {
+        const struct frame_case *c = &frame_cases[i];
+        for (int pp = 0; pp < 2; pp++, cases++) {
+            timeline.pingpong = pp;
+            timeline_case(timeline_frame(c->position) == (pp ? c->pingpong : c->loop),
+                &failed, verbose, pp ? "ping-pong frame" : "frame", 1, (double)c->position);
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(forward_cases) / sizeof(forward_cases[0]); i++, cases++) {
+        const struct forward_case *c = &forward_cases[i];
+        timeline.pingpong = c->pingpong;
+        timeline.speed = c->speed;
+        timeline_case(timeline_forward(c->position) == c->forward, &failed, verbose,
+            c->pingpong ? "ping-pong direction" : "direction", c->speed, (double)c->position);
+    }
+
+    timeline.pingpong = 0;
+    timeline.paused = 0;
+    for (size_t s = 0; s < sizeof(timeline_speeds) / sizeof(timeline_speeds[0]); s++) {
+        for (size_t p = 0; p < sizeof(timeline_starts) / sizeof(timeline_starts[0]); p++) {
+            timeline.speed = timeline_speeds[s];
+            timeline.position = timeline_starts[p];
+            timeline.origin = 1000003;
+
+            for (long long now = timeline.origin - 5; now < timeline.origin + 400000;
+                 now += 7919, cases++) {
+                long long tick = timeline_tick(now), next = timeline_next(now);
+                int ok = next > now && timeline_tick(next) != tick &&
+                    (next - 1 == now || timeline_tick(next - 1) == tick);
+                timeline_case(ok, &failed, verbose, "next tick", timeline.speed,
+                    timeline_starts[p] + (double)(now - timeline.origin) / MICROS_PER_FRAME);
+            }
+        }
+    }
+
+    for (int offset = 0; offset < 2; offset++) {
+        frame_offset = offset ? 17 : 0;
+        for (size_t i = 0; i < sizeof(pingpong_ticks) / sizeof(pingpong_ticks[0]); i++) {
+            for (int pp = 0; pp < 2; pp++, cases++) {
+                long long now = 5000000;
+                timeline.pingpong = pp;
+                timeline.speed = 1;
+                timeline.origin = now;
+                timeline.position = (double)(pingpong_ticks[i] - frame_offset) + 0.25;
+
+                size_t before = timeline_frame(timeline_tick(now) + frame_offset);
+                timeline_pingpong(now);
+                size_t after = timeline_frame(timeline_tick(now) + frame_offset);
+                double fraction = timeline.position - floor(timeline.position);
+
+                timeline_case(before == after && fraction == 0.25 && timeline.pingpong != pp,
+                    &failed, verbose, pp ? "ping-pong off" : "ping-pong on", 1,
+                    (double)pingpong_ticks[i]);
+            }
+        }
+    }
+
+    timeline = saved;
+    frame_offset = saved_offset;
+    printf("timeline %s: %d of %d cases differ\n", failed ? "FAIL" : "ok", failed, cases);
+    return failed ? 1 : 0;
+}
+
+struct power_case {
+    const char *name;
+    double load;            /* per CPU */
+    const char *status;
+    const char *capacity;
+    int divisor;
+};
+
+static const struct power_case power_cases[] = {
+    {"idle", 0.2, "Charging", "80", 1},
+    {"high load", 1.5, "Full", "100", 2},
+    {"very high load", 2.5, "Charging", "80", 4},
+    {"discharging", 0.2, "Discharging", "80", 2},
+    {"low battery", 0.2, "Discharging", "15", 4},
+    {"low but charging", 0.2, "Charging", "15", 1},
+};
+
+static const char *const power_dirs[] = {
+    "/proc", "/sys", "/sys/class", "/sys/class/power_supply",
+    "/sys/class/power_supply/AC", "/sys/class/power_supply/BAT0",
+};
+
+static const char *const power_files[] = {
+    "/proc/loadavg", "/sys/class/power_supply/AC/type",
+    "/sys/class/power_supply/BAT0/type", "/sys/class/power_supply/BAT0/status",
+    "/sys/class/power_supply/BAT0/capacity",
+};
+
+static int write_sys(const char *root, const char *path, const char *value) {
+    char full[512];
+    snprintf(full, sizeof(full), "%s%s", root, path);
+
+    FILE *f = fopen(full, "w");
+    if (!f) return -1;
+    fprintf(f, "%s\n", value);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static int write_power_case(const char *root, const struct power_case *c) {
+    char load[64];
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    snprintf(load, sizeof(load), "%.2f 0.50 0.25 1/123 4567", c->load * (cpus > 0 ? cpus : 1));
+    return write_sys(root, "/proc/loadavg", load) != 0 ||
+        write_sys(root, "/sys/class/power_supply/BAT0/status", c->status) != 0 ||
+        write_sys(root, "/sys/class/power_supply/BAT0/capacity", c->capacity) != 0 ? -1 : 0;
+}
+
+/*
+ * Run the power-saving policy against a fake /proc and /sys tree with a
+ * mains supply and one battery, a check interval apart, and once more
+ * within the interval, when the files must not be read again.
+ */
+static int verify_power(int verbose) {
+    char root[] = "/tmp/ghost-verify-XXXXXX", path[512];
+    int count = (int)(sizeof(power_cases) / sizeof(power_cases[0]));
+    int failed = 0, status = -1;
+    long long now = 0;
+
+    if (!mkdtemp(root)) return -1;
+    for (size_t i = 0; i < sizeof(power_dirs) / sizeof(power_dirs[0]); i++) {
+        snprintf(path, sizeof(path), "%s%s", root, power_dirs[i]);
+        if (mkdir(path, 0700) != 0) goto out;
+    }
+    if (write_sys(root, "/sys/class/power_supply/AC/type", "Mains") != 0 ||
+        write_sys(root, "/sys/class/power_supply/BAT0/type", "Battery") != 0)
+        goto out;
+
+    setenv("GHOST_SYSROOT", root, 1);
+    power_save = 1;
+
+    for (int i = 0; i < count; i++, now += POWER_CHECK_US) {
+        if (write_power_case(root, &power_cases[i]) != 0) goto out;
+
+        int divisor = power_divisor(now);
+        if (divisor == power_cases[i].divisor) continue;
+        if (verbose)
+            fprintf(stderr, "  power %s: divisor %d, expected %d\n",
+                power_cases[i].name, divisor, power_cases[i].divisor);
+        failed++;
+    }
+
+    if (write_power_case(root, &power_cases[1]) != 0) goto out;
+    if (power_divisor(now - POWER_CHECK_US + 1) != power_cases[count - 1].divisor) {
+        if (verbose) fprintf(stderr, "  power: files read again within the interval\n");
+        failed++;
+    }
+
+    printf("power    %s: %d of %d divisors differ\n", failed ? "FAIL" : "ok",
+        failed, count + 1);
+    status = failed ? 1 : 0;
+
+out:
+    power_save = 0;
+    unsetenv("GHOST_SYSROOT");
+    for (size_t i = 0; i < sizeof(power_files) / sizeof(power_files[0]); i++) {
+        snprintf(path, sizeof(path), "%s%s", root, power_files[i]);
+        unlink(path);
+    }
+    for (size_t i = sizeof(power_dirs) / sizeof(power_dirs[0]); i-- > 0;) {
+        snprintf(path, sizeof(path), "%s%s", root, power_dirs[i]);
+        rmdir(path);
+    }
+    rmdir(root);
+    return status;
+}
+
+int main(int argc, char **argv) {
+    int verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(geometries) / sizeof(geometries[0]); i++) {
+        int r = verify_geometry(&geometries[i], verbose);
+        if (r < 0) {
+            fprintf(stderr, "ghost-verify: cannot render frames\n");
+            return EXIT_FAILURE;
+        }
+        failures += r;
+    }
+
+    /* The last two fill the height, so the canvas starts on the top row. */
+    static const struct wall_geometry walls[] = {
+        {120, 400, 17}, {56, 115, 6}, {90, 250, 2}, {83, 240, 0}, {84, 160, 0},
+    };
+
+    pool_start(POOL_THREADS_MAX);
+    for (size_t i = 0; i < sizeof(walls) / sizeof(walls[0]); i++) {
+        int r = verify_wall(&walls[i], verbose);
+        if (r < 0) {
+            fprintf(stderr, "ghost-verify: cannot render frames\n");
+            return EXIT_FAILURE;
+        }
+        failures += r;
+    }
+    pool_stop();
+
+    for (size_t i = 0; i < sizeof(placements) / sizeof(placements[0]); i++) {
+        int r = verify_overlay(&placements[i], verbose);
+        if (r < 0) {
+            fprintf(stderr, "ghost-verify: cannot render frames\n");
+            return EXIT_FAILURE;
+        }
+        failures += r;
+    }
+
+    static const struct geometry casts[] = {{56, 115}, {60, 140}};
+
+    for (size_t i = 0; i < sizeof(casts) / sizeof(casts[0]); i++) {
+        int r = verify_export(&casts[i], i == 0 ? 1000000.0 / MICROS_PER_FRAME : 24, verbose);
+        if (r < 0) {
+            fprintf(stderr, "ghost-verify: cannot export frames\n");
+            return EXIT_FAILURE;
+        }
+        failures += r;
+    }
+
+    failures += verify_timeline(verbose);
+
+    int power = verify_power(verbose);
+    if (power < 0) {
+        fprintf(stderr, "ghost-verify: cannot build a fake sysroot\n");
+        return EXIT_FAILURE;
+    }
+    failures += power;
+
+    int best = simd_supported();
+    for (int level = SIMD_SSE42; level <= best; level++)
+        failures += verify_simd(level, verbose);
+    simd_select(best);
+
+    /* Both contexts render at the same time, one per thread. */
+    static struct lib_check libs[] = {{{56, 115}, NULL}, {{40, 70}, "35"}};
+    pthread_t threads[sizeof(libs) / sizeof(libs[0])];
+
+    for (size_t i = 0; i < sizeof(libs) / sizeof(libs[0]); i++) {
+        libs[i].verbose = verbose;
+        if (pthread_create(&threads[i], NULL, verify_lib, &libs[i]) != 0) {
+            fprintf(stderr, "ghost-verify: cannot start threads\n");
+            return EXIT_FAILURE;
+        }
+    }
+    for (size_t i = 0; i < sizeof(libs) / sizeof(libs[0]); i++) {
+        pthread_join(threads[i], NULL);
+        if (libs[i].status < 0) {
+            fprintf(stderr, "ghost-verify: cannot render frames with libghost\n");
+            return EXIT_FAILURE;
+        }
+        printf("%3dx%-4d %s: libghost with color %s, %d of %d frames differ, %llu unknown sequences\n",
+            libs[i].g.cols, libs[i].g.rows, libs[i].status ? "FAIL" : "ok",
+            libs[i].color ? libs[i].color : "34", libs[i].failed, 2 * FRAME_COUNT,
+            libs[i].unknown);
+        failures += libs[i].status;
+    }
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
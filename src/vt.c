@@ -0,0 +1,213 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/utf8.h"
+#include "include/vt.h"
+
+enum { GROUND, ESCAPE, CSI_PARAM };
+
+static void clear_cells(struct vt *vt, int row, int from, int to) {
+    struct vt_cell *c = &vt->cells[(size_t)row * vt->cols];
+    for (int i = from; i < to; i++)
+        c[i] = (struct vt_cell){' ', 0};
+}
+
+static int clamp(int v, int lo, int hi) {
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+int vt_init(struct vt *vt, int rows, int cols) {
+    memset(vt, 0, sizeof(*vt));
+    vt->rows = rows;
+    vt->cols = cols;
+    vt->cells = malloc((size_t)rows * cols * sizeof(struct vt_cell));
+    if (!vt->cells) return -1;
+
+    for (int r = 0; r < rows; r++) clear_cells(vt, r, 0, cols);
+    return 0;
+}
+
+void vt_free(struct vt *vt) {
+    free(vt->cells);
+    vt->cells = NULL;
+}
+
+static void put(struct vt *vt, uint32_t ch) {
+    int width = char_width(ch);
+    if (width == 0) return;
+
+    if (vt->wrap_pending || vt->col + width > vt->cols) {
+        vt->col = 0;
+        if (vt->row < vt->rows - 1) vt->row++;
+        vt->wrap_pending = 0;
+    }
+
+    /* Overwriting either half of a wide glyph erases the other half too. */
+    struct vt_cell *line = &vt->cells[(size_t)vt->row * vt->cols];
+    int end = vt->col + width;
+    if (vt->col > 0 && line[vt->col].ch == 0) line[vt->col - 1] = (struct vt_cell){' ', 0};
+    if (end < vt->cols && line[end].ch == 0) line[end] = (struct vt_cell){' ', 0};
+
+    line[vt->col] = (struct vt_cell){ch, vt->fg};
+    if (width == 2) line[vt->col + 1] = (struct vt_cell){0, vt->fg};
+    vt->last_ch = ch;
+
+    if (end >= vt->cols) {
+        vt->col = vt->cols - 1;
+        vt->wrap_pending = 1;
+    } else {
+        vt->col = end;
+    }
+}
+
+static int param(const struct vt *vt, int i, int fallback) {
+    return i < vt->param_count && vt->params[i] > 0 ? vt->params[i] : fallback;
+}
+
+static void sgr(struct vt *vt) {
+    if (vt->param_count == 0) vt->fg = 0;
+
+    for (int i = 0; i < vt->param_count; i++) {
+        int p = vt->params[i];
+        if (p == 0 || p == 39)
+            vt->fg = 0;
+        else if ((p >= 30 && p <= 37) || (p >= 90 && p <= 97))
+            vt->fg = (uint8_t)p;
+    }
+}
+
+static void csi(struct vt *vt, char final) {
+    int n = param(vt, 0, 1);
+
+    if (vt->private_mode) {
+        if ((final == 'h' || final == 'l') && vt->param_count > 0 &&
+            vt->params[0] == 1049) {
+            for (int r = 0; r < vt->rows; r++) clear_cells(vt, r, 0, vt->cols);
+        } else if (final != 'h' && final != 'l') {
+            vt->unknown++;
+        }
+        return;
+    }
+
+    switch (final) {
+    case 'H':
+    case 'f':
+        vt->row = clamp(param(vt, 0, 1) - 1, 0, vt->rows - 1);
+        vt->col = clamp(param(vt, 1, 1) - 1, 0, vt->cols - 1);
+        break;
+    case 'A': vt->row = clamp(vt->row - n, 0, vt->rows - 1); break;
+    case 'B': vt->row = clamp(vt->row + n, 0, vt->rows - 1); break;
+    case 'C': vt->col = clamp(vt->col + n, 0, vt->cols - 1); break;
+    case 'D': vt->col = clamp(vt->col - n, 0, vt->cols - 1); break;
+    case 'G': vt->col = clamp(n - 1, 0, vt->cols - 1); break;
+    case 'd': vt->row = clamp(n - 1, 0, vt->rows - 1); break;
+    case 'K': {
+        int mode = vt->param_count ? vt->params[0] : 0;
+        if (mode == 0) clear_cells(vt, vt->row, vt->col, vt->cols);
+        else if (mode == 1) clear_cells(vt, vt->row, 0, vt->col + 1);
+        else clear_cells(vt, vt->row, 0, vt->cols);
+        break;
+    }
+    case 'J': {
+        int mode = vt->param_count ? vt->params[0] : 0;
+        int from = mode == 0 ? vt->row : 0;
+        int to = mode == 1 ? vt->row + 1 : vt->rows;
+        for (int r = from; r < to; r++) {
+            int c0 = mode == 0 && r == vt->row ? vt->col : 0;
+            int c1 = mode == 1 && r == vt->row ? vt->col + 1 : vt->cols;
+            clear_cells(vt, r, c0, c1);
+        }
+        break;
+    }
+    case 'X':
+        clear_cells(vt, vt->row, vt->col, clamp(vt->col + n, 0, vt->cols));
+        break;
+    case 'b':
+        for (int i = 0; i < n; i++) put(vt, vt->last_ch);
+        return;
+    case 'm':
+        sgr(vt);
+        return;
+    default:
+        vt->unknown++;
+        return;
+    }
+
+    vt->wrap_pending = 0;
+}
+
+static void control(struct vt *vt, unsigned char c) {
+    switch (c) {
+    case '\r': vt->col = 0; break;
+    case '\n': if (vt->row < vt->rows - 1) vt->row++; break;
+    case '\b': if (vt->col > 0) vt->col--; break;
+    default: vt->unknown++; return;
+    }
+    vt->wrap_pending = 0;
+}
+
+void vt_feed(struct vt *vt, const char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)data[i];
+
+        switch (vt->state) {
+        case ESCAPE:
+            if (c == '[') {
+                vt->state = CSI_PARAM;
+                vt->param_count = 0;
+                vt->private_mode = 0;
+            } else if (c == '7') {
+                vt->state = GROUND;
+                vt->saved_row = vt->row;
+                vt->saved_col = vt->col;
+                vt->saved_fg = vt->fg;
+            } else if (c == '8') {
+                vt->state = GROUND;
+                vt->row = vt->saved_row;
+                vt->col = vt->saved_col;
+                vt->fg = vt->saved_fg;
+                vt->wrap_pending = 0;
+            } else {
+                vt->state = GROUND;
+                vt->unknown++;
+            }
+            continue;
+
+        case CSI_PARAM:
+            if (c == '?') {
+                vt->private_mode = 1;
+            } else if (c >= '0' && c <= '9') {
+                if (vt->param_count == 0) vt->params[vt->param_count++] = 0;
+                int *p = &vt->params[vt->param_count - 1];
+                if (*p < 100000) *p = *p * 10 + (c - '0');
+            } else if (c == ';') {
+                if (vt->param_count == 0) vt->params[vt->param_count++] = 0;
+                if (vt->param_count < VT_MAX_PARAMS) vt->params[vt->param_count++] = 0;
+            } else if (c >= 0x40 && c <= 0x7e) {
+                vt->state = GROUND;
+                csi(vt, (char)c);
+            }
+            continue;
+        }
+
+        if (c == 0x1b) {
+            vt->state = ESCAPE;
+            vt->utf8_left = 0;
+        } else if (c < 0x20 || c == 0x7f) {
+            control(vt, c);
+        } else if (c < 0x80) {
+            put(vt, c);
+        } else if ((c & 0xc0) == 0x80) {
+            if (vt->utf8_left == 0) {
+                vt->unknown++;
+                continue;
+            }
+            vt->codepoint = vt->codepoint << 6 | (c & 0x3f);
+            if (--vt->utf8_left == 0) put(vt, vt->codepoint);
+        } else {
+            int extra = c >= 0xf0 ? 3 : c >= 0xe0 ? 2 : 1;
+            vt->codepoint = c & (0x3f >> extra);
+            vt->utf8_left = extra;
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#include "include/ghost.h"
+
+struct tile {
+    struct decoder decoder;
+    long long phase;
+    double speed;
+};
+
+int wall;
+int wall_rows, wall_cols;
+
+static double speeds[WALL_SPEEDS_MAX] = {1};
+static int speed_count = 1;
+
+static struct tile *tiles;
+static const struct frame_slot **frames;
+static char **band_end;
+static int tile_count, band_count, band_rows;
+static long long wall_tick;
+static int failed;
+
+int wall_parse_grid(const char *arg) {
+    char x, extra;
+
+    if (sscanf(arg, "%d%c%d%c", &wall_cols, &x, &wall_rows, &extra) != 3 ||
+        (x != 'x' && x != 'X') || wall_cols < 1 || wall_rows < 1)
+        return -1;
+    return 0;
+}
+
+int wall_parse_speeds(const char *arg) {
+    const char *p = arg;
+
+    for (speed_count = 0; speed_count < WALL_SPEEDS_MAX; ) {
+        char *end;
+        double speed = strtod(p, &end);
+        if (end == p || speed <= 0 || (*end != ',' && *end != '\0'))
+            return -1;
+
+        speeds[speed_count++] = speed;
+        if (*end == '\0') return 0;
+        p = end + 1;
+    }
+
+    return -1;
+}
+
+void wall_grid(void) {
+    if (wall_rows && wall_cols) {
+        set_grid(wall_rows, wall_cols);
+        return;
+    }
+
+    int cols = (term_cols + TILE_WIDTH - IMAGE_WIDTH) / TILE_WIDTH;
+    int rows = (term_rows + TILE_HEIGHT - IMAGE_HEIGHT) / TILE_HEIGHT;
+    set_grid(rows > 0 ? rows : 1, cols > 0 ? cols : 1);
+}
+
+int wall_alloc(void) {
+    int count = grid_rows * grid_cols;
+    int bands = pool_threads() * 2;
+    if (bands > canvas_rows) bands = canvas_rows;
+
+    struct tile *t = realloc(tiles, count * sizeof(struct tile));
+    if (t) tiles = t;
+
+    const struct frame_slot **f = realloc(frames, count * sizeof(*frames));
+    if (f) frames = f;
+
+    char **ends = realloc(band_end, bands * sizeof(char *));
+    if (ends) band_end = ends;
+
+    if (!t || !f || !ends) return -1;
+
+    tile_count = count;
+    band_rows = (canvas_rows + bands - 1) / bands;
+    band_count = (canvas_rows + band_rows - 1) / band_rows;
+
+    for (int i = 0; i < count; i++) {
+        decoder_reset(&tiles[i].decoder);
+        tiles[i].phase = (long long)i * FRAME_COUNT / count;
+        tiles[i].speed = speeds[i % speed_count];
+    }
+
+    return 0;
+}
+
+static void decode_job(int i, void *arg) {
+    struct tile *t = &tiles[i];
+    long long step = (long long)(wall_tick * t->speed);
+    size_t index = timeline_frame(step + t->phase + frame_offset);
+
+    frames[i] = decoder_get(&t->decoder, index);
+    if (!frames[i]) failed = 1;
+}
+
+static void ahead_job(int i, void *arg) {
+    decoder_ahead(&tiles[i].decoder);
+}
+
+static void compose_job(int band, void *arg) {
+    int first = band * band_rows;
+    int last = first + band_rows < canvas_rows ? first + band_rows : canvas_rows;
+    compose_rows(frames, first, last);
+}
+
+static void encode_job(int band, void *arg) {
+    struct encoder e;
+    char *out = arg;
+    int first = band * band_rows;
+    int last = first + band_rows < canvas_rows ? first + band_rows : canvas_rows;
+
+    band_end[band] = encode_rows(&e, out + first * ROW_BYTES(term_cols), first, last);
+}
+
+int wall_decode(long long tick) {
+    wall_tick = tick;
+    failed = 0;
+    pool_run(decode_job, NULL, tile_count);
+    return failed ? -1 : 0;
+}
+
+void wall_compose(void) {
+    pool_run(compose_job, NULL, band_count);
+}
+
+size_t wall_encode(char *out) {
+    char *ptr = out;
+
+    pool_run(encode_job, out, band_count);
+    for (int band = 0; band < band_count; band++) {
+        char *start = out + band * band_rows * ROW_BYTES(term_cols);
+        size_t len = band_end[band] - start;
+        memmove(ptr, start, len);
+        ptr += len;
+    }
+
+    return ptr - out;
+}
+
+void wall_ahead(void) {
+    pool_run(ahead_job, NULL, tile_count);
+}
+
+void wall_free(void) {
+    free(tiles);
+    free(frames);
+    free(band_end);
+    tiles = NULL;
+    frames = NULL;
+    band_end = NULL;
+}